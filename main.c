@@ -20,6 +20,8 @@
 #include <windows.h>
 #include <stdint.h>
 #include "resources.h"
+#include "notes.h"
+#include "trace.h"
 
 // size of the post-it when it's created net
 static const int defaultWidth = 300;
@@ -38,58 +40,62 @@ static const DWORD color_palette[] = {
     RGB(255, 255, 255), // 8 white
 };
 
+// delay in minutes of each option in the "remind me" menu
+static const uint32_t reminder_delays[] = {
+    5,          // 0 in 5 minutes
+    15,         // 1 in 15 minutes
+    60,         // 2 in 1 hour
+    4 * 60,     // 3 in 4 hours
+    24 * 60,    // 4 tomorrow
+};
+
 static const char POSTIT_CLASS_NAME[]  = "PostIt.Post";
 static const char tray_class_name[] = "PostIt.Tray";
 
-// APP SAVED DATA
-// data that gets saved on disk to be persistent
-struct notedata {
-    HWND window;
-    int32_t x, y, w, h;
-    LOGFONT font;
-    HFONT hFont;
-    DWORD color_post;
-    DWORD color_text;
-    char *text;
-};
-
-struct myappdata
-{
-    uint32_t numNotes;
-    DWORD default_color_post;
-    DWORD default_color_text;
-    LOGFONT default_font;
-    struct notedata* notes;
-};
+// the notes file keeps the fonts as LOGFONT records
+_Static_assert(sizeof(struct notefont) == sizeof(LOGFONT), "struct notefont must match LOGFONT");
 
-struct myappdata appdata = {
+struct notelist appdata = {
     .numNotes = 0,
     .default_color_post = color_palette[0],
     .default_color_text = color_palette[8],
-    .default_font = (LOGFONT) {
-            .lfHeight = 0,
-            .lfWidth = 0,
-            .lfEscapement = 0,
-            .lfOrientation = 0,
-            .lfWeight = FW_DONTCARE,
-            .lfItalic = FALSE,
-            .lfUnderline = FALSE,
-            .lfStrikeOut = FALSE,
-            .lfCharSet = DEFAULT_CHARSET,
-            .lfOutPrecision = OUT_DEFAULT_PRECIS,
-            .lfClipPrecision = CLIP_DEFAULT_PRECIS,
-            .lfQuality = ANTIALIASED_QUALITY,
-            .lfPitchAndFamily = DEFAULT_PITCH | FF_DONTCARE,
-            .lfFaceName = "Calibri",
+    .default_font = (struct notefont) {
+            .height = 0,
+            .width = 0,
+            .escapement = 0,
+            .orientation = 0,
+            .weight = FW_DONTCARE,
+            .italic = FALSE,
+            .underline = FALSE,
+            .strikeOut = FALSE,
+            .charSet = DEFAULT_CHARSET,
+            .outPrecision = OUT_DEFAULT_PRECIS,
+            .clipPrecision = CLIP_DEFAULT_PRECIS,
+            .quality = ANTIALIASED_QUALITY,
+            .pitchAndFamily = DEFAULT_PITCH | FF_DONTCARE,
+            .faceName = "Calibri",
         },
     .notes = NULL
     };
 
 int lastActiveNote = -1;
 
+// single timer armed for the earliest pending reminder of all notes
+HANDLE reminderTimer = NULL;
+
 char filename[MAX_PATH] = "";
 
+// opt-in recording of the events that change the notes, enabled with --trace
+struct tracefile eventTrace = { 0 };
+LARGE_INTEGER traceFrequency;
+LARGE_INTEGER traceStart;
+
+// tags listed in the tray menu - limited by the range of menu ids
+static const uint32_t max_menu_tags = MENU_ITEM_TAG_EXCLUDE_F - MENU_ITEM_TAG_REQUIRE_F;
+
 int UpdateFile(char* filename);
+void ApplyTagFilterToNote(struct notedata* note);
+char* RequiredTagsText();
 // ==============
 
 // searches the list of posts for a specific window
@@ -111,16 +117,107 @@ struct notedata* FindNoteByHwnd(HWND hwnd, int* out_index)
     return NULL;
 };
 
-void DeleteNote(int index)
+// microseconds since the recording started, for timestamping the trace
+uint64_t TraceClock()
 {
-    free(appdata.notes[index].text); // free the text buffer of that post
+    if (eventTrace.fp == NULL)
+        return 0; // not recording
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
 
-    for (int i = index; i < appdata.numNotes - 1; i++) // push back each list entry to close the gap
-         appdata.notes[i] = appdata.notes[i+1];
+    // whole seconds and the remainder apart, so the product can't overflow on long recordings
+    uint64_t ticks = now.QuadPart - traceStart.QuadPart;
+    uint64_t frequency = traceFrequency.QuadPart;
 
-    // TODO (maybe): realloc shrinked list of posts
+    return ticks / frequency * 1000000 + ticks % frequency * 1000000 / frequency;
+}
+
+// current time in the units of the reminder queue
+uint64_t ReminderClock(void* context)
+{
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+
+    uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime; // 100ns since 1601
+    return ticks / 10000 - 11644473600000ULL;
+}
+
+// points the timer at the earliest pending reminder, or stops it if there is none
+void ArmReminderTimer()
+{
+    if (reminderTimer == NULL)
+        return;
+
+    uint64_t due;
+    if (!ReminderNext(&appdata.reminders, &due))
+    {
+        CancelWaitableTimer(reminderTimer);
+        return;
+    }
+
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = (LONGLONG)((due + 11644473600000ULL) * 10000); // positive value means absolute FILETIME
+
+    SetWaitableTimer(reminderTimer, &dueTime, 0, NULL, NULL, FALSE);
+}
+
+// sets (or clears, when due is zero) the reminder of a note
+void SetNoteReminder(struct notedata* note, uint64_t due)
+{
+    if (NotesSetReminder(&appdata, note, due))
+        TraceReminder(&eventTrace, note->id, TraceClock(), due);
+    else
+        fprintf(stderr, "\nFailed to schedule reminder");
+
+    ArmReminderTimer();
+}
+
+// called when the reminder timer is signaled - brings every note that is due to the front
+void FireDueReminders()
+{
+    uint32_t ids[256];
+    uint32_t numFired = 0;
+    uint32_t numPopped;
+
+    // drain the queue in batches, handling each note by the id that left it
+    while ((numPopped = NotesPopDueReminders(&appdata, ids, sizeof(ids)/sizeof(ids[0]))) > 0)
+    {
+        for (uint32_t i = 0; i < numPopped; i++)
+        {
+            struct notedata* note = NotesFindById(&appdata, ids[i], NULL);
+            if (note == NULL)
+                continue;
+
+            TraceReminder(&eventTrace, note->id, TraceClock(), 0);
+            numFired++;
+
+            ShowWindow(note->window, SW_SHOWNORMAL);
+            SetForegroundWindow(note->window);
+
+            FLASHWINFO fwi = {
+                .cbSize = sizeof(FLASHWINFO),
+                .hwnd = note->window,
+                .dwFlags = FLASHW_ALL | FLASHW_TIMERNOFG,
+                .uCount = 5,
+                .dwTimeout = 0,
+            };
+            FlashWindowEx(&fwi);
+        }
+    }
+
+    ArmReminderTimer();
+
+    if (numFired > 0)
+        UpdateFile(filename); // the fired reminders are cleared from the saved file
+}
+
+void DeleteNote(int index)
+{
+    TraceEvent(&eventTrace, TRACE_NOTE_DELETE, appdata.notes[index].id, TraceClock());
+    NotesDelete(&appdata, index); // also cancels its reminder, which needs no trace record of its own
+    ArmReminderTimer();
 
-    appdata.numNotes--;
     lastActiveNote = -1;
 }
 
@@ -147,10 +244,10 @@ LRESULT CALLBACK MainProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 if (new_text == NULL)
                     break;
 
-                free(note->text);
-                note->text = new_text;
-
                 GetWindowTextA(edit, new_text, len);
+                TraceText(&eventTrace, note->id, TraceClock(), note->text, new_text);
+
+                NotesSetText(&appdata, note, new_text);
             }
         break;
 
@@ -192,6 +289,8 @@ LRESULT CALLBACK MainProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             note->y = rcClient.top;
             note->w = rcClient.right - rcClient.left;
             note->h = rcClient.bottom - rcClient.top;
+
+            TracePlacement(&eventTrace, (uMsg == WM_SIZE) ? TRACE_SIZE : TRACE_MOVE, note->id, TraceClock(), note->x, note->y, note->w, note->h);
         }
         break;
 
@@ -212,9 +311,17 @@ LRESULT CALLBACK MainProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
         case WM_ACTIVATE:
             if (wParam == WA_ACTIVE || wParam == WA_CLICKACTIVE)
+            {
+                TraceEvent(&eventTrace, TRACE_ACTIVATE, note->id, TraceClock());
                 lastActiveNote = note_index;
+            }
             else
+            {
+                TraceEvent(&eventTrace, TRACE_DEACTIVATE, note->id, TraceClock());
+                NotesUpdateTags(&appdata, note); // the words typed are complete now, any new #tags are created
+                ApplyTagFilterToNote(note); // hide it if the edit took it out of the filter
                 UpdateFile(filename); // we update the saved file every time the user interacts with a note
+            }
         break;
 
         default: break;
@@ -225,21 +332,23 @@ LRESULT CALLBACK MainProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 }
 
 #include <commdlg.h>
-HFONT PostChooseFont(LOGFONT* logf, WINBOOL bDefault)
+HFONT PostChooseFont(struct notefont* font, WINBOOL bDefault)
 {
+    LOGFONT* logf = (LOGFONT*)font;
+
     if (logf == NULL)
         return NULL;
 
     if (bDefault)
     {
-        if (appdata.default_font.lfHeight == 0)
+        if (appdata.default_font.height == 0)
         {
             HDC hDC = GetDC(HWND_DESKTOP);
-            appdata.default_font.lfHeight = -MulDiv(16, GetDeviceCaps(hDC, LOGPIXELSY), 72);
+            appdata.default_font.height = -MulDiv(16, GetDeviceCaps(hDC, LOGPIXELSY), 72);
             ReleaseDC(NULL, hDC);
         }
 
-        *logf = appdata.default_font;
+        *font = appdata.default_font;
     }
     else
     {
@@ -299,41 +408,42 @@ HWND CreatePostItWindow(HINSTANCE inst, HFONT hFont, char* initialText, int32_t
 
 struct notedata* NewNote()
 {
-    // create one new slot in buffer
-    struct notedata* new_list = (struct notedata*)realloc(appdata.notes, sizeof(struct notedata) * (appdata.numNotes + 1));
-    if (new_list == NULL)
+    // create one new slot in the list, with the default colors
+    struct notedata* new_note = NotesAdd(&appdata);
+    if (new_note == NULL)
     {
         fprintf(stderr, "\nRealloc for new item failed!");
         return NULL;
     }
 
-    // if the reallocation was successful, update our table to the new pointer
-    appdata.notes = new_list;
-    appdata.numNotes++;
+    TraceEvent(&eventTrace, TRACE_NOTE_NEW, new_note->id, TraceClock());
 
-    // assign default values to the new post
-    struct notedata* new_note = &appdata.notes[appdata.numNotes-1];
+    // under a filter the new note starts with the required #tags, so it is one of the notes shown
+    char* initialText = RequiredTagsText();
+    if (initialText != NULL)
+    {
+        TraceText(&eventTrace, new_note->id, TraceClock(), NULL, initialText);
+        NotesSetText(&appdata, new_note, initialText);
+        TraceEvent(&eventTrace, TRACE_TAGS, new_note->id, TraceClock());
+        NotesUpdateTags(&appdata, new_note);
+    }
 
-    new_note->text = NULL;
     new_note->x = CW_USEDEFAULT;
     new_note->y = CW_USEDEFAULT;
     new_note->w = defaultWidth;
     new_note->h = defaultHeight;
-    new_note->color_post = appdata.default_color_post;
-    new_note->color_text = appdata.default_color_text;
     new_note->hFont = PostChooseFont(&new_note->font, TRUE);
     new_note->window = CreatePostItWindow(NULL, new_note->hFont, new_note->text, new_note->x, new_note->y, new_note->w, new_note->h, TRUE);
     lastActiveNote = appdata.numNotes-1;
 
+    ApplyTagFilterToNote(new_note);
+
     return new_note;
 }
 
 void CloseAll()
 {
-    for (int noteIndex = 0; noteIndex < appdata.numNotes; noteIndex++)
-        free(appdata.notes[noteIndex].text); // releases the text buffers
-
-    free(appdata.notes); // release the post themselves
+    NotesFree(&appdata); // releases the text buffers and the posts themselves
 }
 
 
@@ -364,13 +474,158 @@ HBITMAP BitmapFromIcon(HICON hIcon, WINBOOL bDestroy)
     return hDibBmp;
 }
 
+// shows the notes that pass the tag filter and hides the others, all in a single batched window update
+void ApplyTagFilter(WINBOOL bRaise)
+{
+    struct tagbitmap visible;
+    TagBitmapInit(&visible);
+
+    if (!TagIndexQuery(&appdata.tags, &appdata.filter, &visible))
+    {
+        TagBitmapFree(&visible);
+        return;
+    }
+
+    HWND firstVisible = NULL;
+    HDWP hdwp = BeginDeferWindowPos(appdata.numNotes);
+
+    for (int noteIndex = 0; hdwp != NULL && noteIndex < appdata.numNotes; noteIndex++)
+    {
+        struct notedata* note = &appdata.notes[noteIndex];
+        UINT flags = SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE;
+
+        if (TagBitmapTest(&visible, note->id))
+        {
+            flags |= SWP_SHOWWINDOW | (bRaise ? 0 : SWP_NOZORDER);
+
+            if (firstVisible == NULL)
+                firstVisible = note->window;
+        }
+        else
+            flags |= SWP_HIDEWINDOW | SWP_NOZORDER;
+
+        hdwp = DeferWindowPos(hdwp, note->window, HWND_TOP, 0, 0, 0, 0, flags); // on failure the whole batch is discarded
+    }
+
+    if (hdwp != NULL)
+        EndDeferWindowPos(hdwp);
+
+    // the app must become the foreground one for the raised notes to show above other programs
+    if (bRaise && firstVisible != NULL)
+        SetForegroundWindow(firstVisible);
+
+    TagBitmapFree(&visible);
+}
+
+// shows or hides a single note according to the tag filter
+void ApplyTagFilterToNote(struct notedata* note)
+{
+    WINBOOL bVisible = TagIndexMatches(&appdata.tags, &appdata.filter, note->id);
+
+    if (bVisible != (IsWindowVisible(note->window) != FALSE))
+        ShowWindow(note->window, bVisible ? SW_SHOWNA : SW_HIDE);
+}
+
+// text with the #tags the filter requires, or NULL if it requires none
+char* RequiredTagsText()
+{
+    uint32_t len = 0;
+
+    for (uint32_t tag = 0; tag < appdata.tags.numTags; tag++)
+    {
+        if (TagBitmapTest(&appdata.filter.required, tag))
+            len += strlen(appdata.tags.names[tag]) + 2; // "#name "
+    }
+
+    if (len == 0)
+        return NULL;
+
+    char* text = (char*)calloc(sizeof(char), len + 1);
+    if (text == NULL)
+        return NULL;
+
+    for (uint32_t tag = 0; tag < appdata.tags.numTags; tag++)
+    {
+        if (!TagBitmapTest(&appdata.filter.required, tag))
+            continue;
+
+        strcat(text, "#");
+        strcat(text, appdata.tags.names[tag]);
+        strcat(text, " ");
+    }
+
+    return text;
+}
+
+// adds or removes a tag from one side of the filter
+void ToggleTagFilter(uint32_t tag, WINBOOL bExclude)
+{
+    struct tagbitmap* toggled = bExclude ? &appdata.filter.excluded : &appdata.filter.required;
+    struct tagbitmap* other = bExclude ? &appdata.filter.required : &appdata.filter.excluded;
+
+    int value = !TagBitmapTest(toggled, tag);
+    TagBitmapSet(toggled, tag, value);
+
+    if (value)
+        TagBitmapSet(other, tag, 0); // a tag can't be both required and excluded
+
+    ApplyTagFilter(FALSE);
+    UpdateFile(filename);
+}
+
+// lists the tags in use under the "Tags" popup of the tray menu
+void FillTagMenu(HMENU hmenuTags)
+{
+    HMENU hmenuRequire = CreatePopupMenu();
+    HMENU hmenuExclude = CreatePopupMenu();
+    int numListed = 0;
+
+    if (TagFilterIsEmpty(&appdata.filter))
+        CheckMenuItem(hmenuTags, MENU_ITEM_TAG_CLEAR, MF_BYCOMMAND | MF_CHECKED);
+
+    for (uint32_t tag = 0; tag < appdata.tags.numTags && tag < max_menu_tags; tag++)
+    {
+        WINBOOL bRequired = TagBitmapTest(&appdata.filter.required, tag);
+        WINBOOL bExcluded = TagBitmapTest(&appdata.filter.excluded, tag);
+
+        // skip tags no longer used by any note, unless the filter still refers to them
+        if (TagBitmapIsEmpty(&appdata.tags.notes[tag]) && !bRequired && !bExcluded)
+            continue;
+
+        char label[TAG_MAX_LENGTH + 2];
+        snprintf(label, sizeof(label), "#%s", appdata.tags.names[tag]);
+
+        AppendMenu(hmenuRequire, MF_STRING | (bRequired ? MF_CHECKED : 0), MENU_ITEM_TAG_REQUIRE_F + tag, label);
+        AppendMenu(hmenuExclude, MF_STRING | (bExcluded ? MF_CHECKED : 0), MENU_ITEM_TAG_EXCLUDE_F + tag, label);
+        numListed++;
+    }
+
+    // the menu ids only have room for so many tags
+    if (appdata.tags.numTags > max_menu_tags)
+    {
+        AppendMenu(hmenuRequire, MF_STRING | MF_GRAYED, 0, "More tags not shown");
+        AppendMenu(hmenuExclude, MF_STRING | MF_GRAYED, 0, "More tags not shown");
+    }
+
+    if (numListed == 0)
+    {
+        AppendMenu(hmenuRequire, MF_STRING | MF_GRAYED, 0, "No #tags in the notes");
+        AppendMenu(hmenuExclude, MF_STRING | MF_GRAYED, 0, "No #tags in the notes");
+    }
+
+    // the submenus are destroyed along with the parent menu
+    AppendMenu(hmenuTags, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hmenuTags, MF_POPUP, (UINT_PTR)hmenuRequire, "Only with");
+    AppendMenu(hmenuTags, MF_POPUP, (UINT_PTR)hmenuExclude, "Hide with");
+}
+
 // called when user mouse-clicks the tray icon
 void TrayPopup(HWND hwnd)
 {
     HMENU hmenu;
     HMENU hmenuTrackPopup;
     int item;
-    const static int menu_item_icon_list[] = {MENU_ITEM_NEW, MENU_ITEM_SHOW, MENU_ITEM_FONT, MENU_ITEM_TEXT_COLOR, MENU_ITEM_BACK_COLOR, MENU_ITEM_CLOSE}; // matches icon to menu item index
+    const static int menu_item_icon_list[] = {MENU_ITEM_NEW, MENU_ITEM_SHOW, MENU_ITEM_TAG, MENU_ITEM_REMIND, MENU_ITEM_FONT, MENU_ITEM_TEXT_COLOR, MENU_ITEM_BACK_COLOR, MENU_ITEM_CLOSE}; // matches icon to menu item index
 
     // load the context menu from the resources file
     if ((hmenu = LoadMenu(NULL, "TrayMenu")) == NULL)
@@ -395,6 +650,11 @@ void TrayPopup(HWND hwnd)
         openBmp[i] = mif.hbmpItem;
 
         SetMenuItemInfo(hmenuTrackPopup, i, TRUE, &mif);
+
+        // the tags popup is the one that starts with the "show all tags" item
+        HMENU hmenuSub = GetSubMenu(hmenuTrackPopup, i);
+        if (hmenuSub != NULL && GetMenuItemID(hmenuSub, 0) == MENU_ITEM_TAG_CLEAR)
+            FillTagMenu(hmenuSub);
     }
 
 
@@ -411,9 +671,14 @@ void TrayPopup(HWND hwnd)
             NewNote();
         break;
 
-        case MENU_ITEM_SHOW: // show all
-            for (int noteIndex = 0; noteIndex < appdata.numNotes; noteIndex++)
-                SetForegroundWindow(appdata.notes[noteIndex].window);
+        case MENU_ITEM_SHOW: // show all - that pass the tag filter
+            ApplyTagFilter(TRUE);
+        break;
+
+        case MENU_ITEM_TAG_CLEAR: // show all tags
+            TagFilterFree(&appdata.filter);
+            ApplyTagFilter(FALSE);
+            UpdateFile(filename);
         break;
 
         case MENU_ITEM_FONT: // change font
@@ -433,6 +698,11 @@ void TrayPopup(HWND hwnd)
             }
         break;
 
+        case MENU_ITEM_REMIND_CLEAR: // clear reminder
+            if (lastActiveNote >= 0)
+                SetNoteReminder(&appdata.notes[lastActiveNote], 0);
+        break;
+
         case MENU_ITEM_CLOSE: // close
             PostQuitMessage(0);
         break;
@@ -463,6 +733,15 @@ void TrayPopup(HWND hwnd)
                     InvalidateRect(appdata.notes[lastActiveNote].window, NULL, TRUE);
                 }
             }
+            else if (item >= MENU_ITEM_REMIND_F && item < MENU_ITEM_REMIND_F + sizeof(reminder_delays)/sizeof(reminder_delays[0]))
+            {
+                if (lastActiveNote >= 0)
+                    SetNoteReminder(&appdata.notes[lastActiveNote], ReminderClock(NULL) + (uint64_t)reminder_delays[item - MENU_ITEM_REMIND_F] * 60 * 1000);
+            }
+            else if (item >= MENU_ITEM_TAG_REQUIRE_F && item < MENU_ITEM_TAG_REQUIRE_F + max_menu_tags)
+                ToggleTagFilter(item - MENU_ITEM_TAG_REQUIRE_F, FALSE);
+            else if (item >= MENU_ITEM_TAG_EXCLUDE_F && item < MENU_ITEM_TAG_EXCLUDE_F + max_menu_tags)
+                ToggleTagFilter(item - MENU_ITEM_TAG_EXCLUDE_F, TRUE);
         break;
    }
 
@@ -511,79 +790,40 @@ int LoadFromFile(char* filename, HINSTANCE hInstance)
         return FALSE;
     }
 
-    // read number of notes saved
-    if (fread(&appdata.numNotes, sizeof(appdata.numNotes), 1, fp) != 1)
-        return FALSE;
+    int bOk = NotesLoad(&appdata, fp);
 
-    printf("\nSaved notes count: %d", appdata.numNotes);
-
-    // save default font
-    if (fread(&appdata.default_font, sizeof(appdata.default_font), 1, fp) != 1)
-        return FALSE;
+    // release the file
+    fclose(fp);
 
-    // read color scheme
-    if (fread(&appdata.default_color_post, sizeof(appdata.default_color_post), 1, fp) != 1)
+    if (!bOk)
         return FALSE;
 
-    if (fread(&appdata.default_color_text, sizeof(appdata.default_color_text), 1, fp) != 1)
-        return FALSE;
+    printf("\nSaved notes count: %d", appdata.numNotes);
 
-    // alloc space for all the notes and then read each one from the file
-    appdata.notes = (struct notedata*)calloc(sizeof(struct notedata), appdata.numNotes);
+    // create a window for each note read
     for (int noteIndex = 0; noteIndex < appdata.numNotes; noteIndex++)
     {
         struct notedata* note = &appdata.notes[noteIndex];
 
-        uint32_t len = 0;
-
-        // how long is the text?
-        if (fread(&len, sizeof(len), 1, fp) != 1)
-            break;
-
-        // get placement data - position and size
-        if (fread(&note->x, sizeof(note->x), 1, fp) != 1)
-            break;
-
-        if (fread(&note->y, sizeof(note->y), 1, fp) != 1)
-            break;
-
-        if (fread(&note->w, sizeof(note->w), 1, fp) != 1)
-            break;
-
-        if (fread(&note->h, sizeof(note->h), 1, fp) != 1)
-            break;
-
-        // read font info
-        if (fread(&note->font, sizeof(note->font), 1, fp) != 1)
-            break;
-
-        // read color scheme
-        if (fread(&note->color_post, sizeof(note->color_post), 1, fp) != 1)
-            break;
-
-        if (fread(&note->color_text, sizeof(note->color_text), 1, fp) != 1)
-            break;
-
-        // alloc space for the text and then read it
-        note->text = (char*)calloc(sizeof(char), len + 1);
-
-        if (fread(note->text, sizeof(char), len, fp) != len)
-            break;
-
-        note->hFont = CreateFontIndirect(&note->font);
+        note->hFont = CreateFontIndirect((LOGFONT*)&note->font);
         note->window = CreatePostItWindow(hInstance, note->hFont, note->text, note->x, note->y, note->w, note->h, FALSE);
 
         printf("Read note %d/%d: %s", noteIndex + 1, appdata.numNotes, note->text);
     }
 
-    // release the file
-    fclose(fp);
+    // hide the notes that don't pass the saved tag filter
+    if (!TagFilterIsEmpty(&appdata.filter))
+        ApplyTagFilter(FALSE);
+
+    ArmReminderTimer();
 
     return TRUE;
 }
 
 int UpdateFile(char* filename)
 {
+    TraceEvent(&eventTrace, TRACE_SAVE, 0, TraceClock());
+
     // opens file for reading
     FILE* fp = fopen(filename, "wb+");
 
@@ -593,50 +833,29 @@ int UpdateFile(char* filename)
         return FALSE;
     }
 
-    // write number of entries
-    fwrite(&appdata.numNotes, sizeof(appdata.numNotes), 1, fp);
+    int bOk = NotesSave(&appdata, fp);
 
-    // save default font
-    fwrite(&appdata.default_font, sizeof(appdata.default_font), 1, fp);
+    fclose(fp);
 
-    // save color scheme
-    fwrite(&appdata.default_color_post, sizeof(appdata.default_color_post), 1, fp);
-    fwrite(&appdata.default_color_text, sizeof(appdata.default_color_text), 1, fp);
+    return bOk;
+}
 
-    // write the entries
+// starts the trace with the notes that already exist, so it can be replayed from an empty state
+void TraceSnapshot()
+{
     for (int noteIndex = 0; noteIndex < appdata.numNotes; noteIndex++)
     {
         struct notedata* note = &appdata.notes[noteIndex];
+        uint64_t time = TraceClock();
 
-        uint32_t len = 0;
-
-        if (note->text != NULL)
-            len = strlen(note->text);
-
-        // write the length of the text in this entry
-        fwrite(&len, sizeof(len), 1, fp);
-
-        // write position and size
-        fwrite(&note->x, sizeof(note->x), 1, fp);
-        fwrite(&note->y, sizeof(note->y), 1, fp);
-        fwrite(&note->w, sizeof(note->w), 1, fp);
-        fwrite(&note->h, sizeof(note->h), 1, fp);
-
-        // write font info
-        fwrite(&note->font, sizeof(note->font), 1, fp);
+        TraceEvent(&eventTrace, TRACE_NOTE_NEW, note->id, time);
+        TraceText(&eventTrace, note->id, time, NULL, note->text);
+        TraceEvent(&eventTrace, TRACE_TAGS, note->id, time); // NotesLoad created the tags of the text
+        TracePlacement(&eventTrace, TRACE_MOVE, note->id, time, note->x, note->y, note->w, note->h);
 
-        // write color scheme
-        fwrite(&note->color_post, sizeof(note->color_post), 1, fp);
-        fwrite(&note->color_text, sizeof(note->color_text), 1, fp);
-
-        // write the actual text
-        if (note->text != NULL)
-            fwrite(note->text, sizeof(note->text[0]), len, fp);
+        if (note->remind_at != 0)
+            TraceReminder(&eventTrace, note->id, time, note->remind_at);
     }
-
-    fclose(fp);
-
-    return TRUE;
 }
 
 #include "Shlwapi.h"
@@ -680,21 +899,56 @@ INT WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     if (!Shell_NotifyIcon( NIM_ADD, &nid ))
         return -1;
 
+    // a single timer serves the reminders of all notes
+    NotesInit(&appdata, ReminderClock, NULL);
+
+    if ((reminderTimer = CreateWaitableTimer(NULL, FALSE, NULL)) == NULL)
+        fprintf(stderr, "\nCreateWaitableTimer failed");
+
     // load saved notes
     GetModuleFileNameA(NULL, filename, MAX_PATH - 6);
     strcat(filename, ".data");
 
-    if (!LoadFromFile(filename, hInstance))
+    int bLoaded = LoadFromFile(filename, hInstance);
+    if (!bLoaded)
     {
+        fprintf(stderr, "\nNotes file could not be read, it is left untouched");
         goto BAIL;
     }
 
-    // main loop
+    // record the events to a trace next to the notes file when asked to
+    if (strstr(lpCmdLine, "--trace") != NULL)
+    {
+        char traceFilename[MAX_PATH] = "";
+        GetModuleFileNameA(NULL, traceFilename, MAX_PATH - 7);
+        strcat(traceFilename, ".trace");
+
+        QueryPerformanceFrequency(&traceFrequency);
+        QueryPerformanceCounter(&traceStart);
+
+        // the wall clock at the start lets the replay fire the reminders at the right moment
+        if (TraceCreate(&eventTrace, traceFilename, sizeof(struct notefont), ReminderClock(NULL)))
+            TraceSnapshot();
+        else
+            fprintf(stderr, "\nError creating trace file");
+    }
+
+    // main loop - waits for either window messages or the reminder timer
     MSG msg = { };
-    while (GetMessage(&msg, NULL, 0, 0))
+    for (;;)
     {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+        DWORD numHandles = (reminderTimer != NULL) ? 1 : 0;
+        if (MsgWaitForMultipleObjects(numHandles, &reminderTimer, FALSE, INFINITE, QS_ALLINPUT) == WAIT_OBJECT_0 && numHandles > 0)
+            FireDueReminders();
+
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        {
+            if (msg.message == WM_QUIT)
+                goto BAIL;
+
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
     }
 
     // cleanup tray and classes
@@ -703,9 +957,14 @@ INT WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     UnregisterClass(POSTIT_CLASS_NAME, hInstance);
     UnregisterClass(tray_class_name, hInstance);
 
-    // save the changes to the notes and releases memory
-    UpdateFile(filename);
+    // save the changes to the notes and releases memory - but never overwrite a file that could not be read
+    if (bLoaded)
+        UpdateFile(filename);
     CloseAll();
+    TraceClose(&eventTrace);
+
+    if (reminderTimer != NULL)
+        CloseHandle(reminderTimer);
 
     return 0;
 }
@@ -0,0 +1,400 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+#include <stdlib.h>
+#include <string.h>
+#include "notes.h"
+
+void NotesInit(struct notelist* list, reminder_clock clock, void* clockContext)
+{
+    list->numNotes = 0;
+    list->notes = NULL;
+    list->nextNoteId = 0;
+    list->indexById = NULL;
+    list->numIds = 0;
+
+    ReminderInit(&list->reminders, clock, clockContext);
+    TagIndexInit(&list->tags);
+    TagFilterInit(&list->filter);
+}
+
+void NotesFree(struct notelist* list)
+{
+    for (uint32_t noteIndex = 0; noteIndex < list->numNotes; noteIndex++)
+        free(list->notes[noteIndex].text); // releases the text buffers
+
+    free(list->notes); // release the post themselves
+    free(list->indexById);
+
+    ReminderFree(&list->reminders);
+    TagIndexFree(&list->tags);
+    TagFilterFree(&list->filter);
+
+    list->numNotes = 0;
+    list->notes = NULL;
+    list->indexById = NULL;
+    list->numIds = 0;
+}
+
+// gives the note at the given position a new id and records where it is
+static int NotesAssignId(struct notelist* list, uint32_t index)
+{
+    uint32_t id = list->nextNoteId;
+
+    if (id == NOTE_NONE)
+        return 0;
+
+    // grow the id lookup table to cover this id
+    if (id >= list->numIds)
+    {
+        uint32_t newNumIds = (list->numIds == 0) ? 64 : list->numIds;
+        while (newNumIds <= id)
+            newNumIds = (newNumIds > 0x7FFFFFFF) ? NOTE_NONE : newNumIds * 2;
+
+        uint32_t* new_index = (uint32_t*)realloc(list->indexById, sizeof(uint32_t) * newNumIds);
+        if (new_index == NULL)
+            return 0;
+
+        for (uint32_t i = list->numIds; i < newNumIds; i++)
+            new_index[i] = NOTE_NONE;
+
+        list->indexById = new_index;
+        list->numIds = newNumIds;
+    }
+
+    list->notes[index].id = id;
+    list->indexById[id] = index;
+    list->nextNoteId++;
+
+    return 1;
+}
+
+struct notedata* NotesAdd(struct notelist* list)
+{
+    // create one new slot in buffer
+    struct notedata* new_list = (struct notedata*)realloc(list->notes, sizeof(struct notedata) * (list->numNotes + 1));
+    if (new_list == NULL)
+        return NULL;
+
+    // if the reallocation was successful, update our table to the new pointer
+    list->notes = new_list;
+
+    // assign default values to the new post
+    struct notedata* new_note = &list->notes[list->numNotes];
+    memset(new_note, 0, sizeof(struct notedata));
+
+    new_note->font = list->default_font;
+    new_note->color_post = list->default_color_post;
+    new_note->color_text = list->default_color_text;
+
+    if (!NotesAssignId(list, list->numNotes))
+        return NULL;
+
+    list->numNotes++;
+    TagIndexUpdateNote(&list->tags, new_note->id, new_note->text, 1);
+
+    return new_note;
+}
+
+void NotesDelete(struct notelist* list, uint32_t index)
+{
+    struct notedata* note = &list->notes[index];
+
+    ReminderCancel(&list->reminders, note->id); // a deleted note can't be reminded of
+    TagIndexRemoveNote(&list->tags, note->id);
+    list->indexById[note->id] = NOTE_NONE;
+    free(note->text); // free the text buffer of that post
+
+    for (uint32_t i = index; i < list->numNotes - 1; i++) // push back each list entry to close the gap
+    {
+        list->notes[i] = list->notes[i+1];
+        list->indexById[list->notes[i].id] = i;
+    }
+
+    // TODO (maybe): realloc shrinked list of posts
+
+    list->numNotes--;
+}
+
+struct notedata* NotesFindById(const struct notelist* list, uint32_t id, uint32_t* out_index)
+{
+    if (id >= list->numIds || list->indexById[id] == NOTE_NONE)
+        return NULL;
+
+    if (out_index != NULL)
+        *out_index = list->indexById[id];
+
+    return &list->notes[list->indexById[id]];
+}
+
+int NotesSetText(struct notelist* list, struct notedata* note, char* text)
+{
+    free(note->text);
+    note->text = text;
+
+    return TagIndexUpdateNote(&list->tags, note->id, note->text, 0); // the #tags may have changed
+}
+
+int NotesUpdateTags(struct notelist* list, struct notedata* note)
+{
+    return TagIndexUpdateNote(&list->tags, note->id, note->text, 1);
+}
+
+int NotesSetReminder(struct notelist* list, struct notedata* note, uint64_t due)
+{
+    if (due == 0)
+        ReminderCancel(&list->reminders, note->id);
+    else if (!ReminderSchedule(&list->reminders, note->id, due))
+        return 0; // the note keeps whatever reminder it had
+
+    // a note only has a reminder while it is in the queue
+    note->remind_at = due;
+
+    return 1;
+}
+
+uint32_t NotesPopDueReminders(struct notelist* list, uint32_t* ids, uint32_t maxIds)
+{
+    uint32_t numPopped = ReminderPopDue(&list->reminders, ids, maxIds);
+
+    for (uint32_t i = 0; i < numPopped; i++)
+    {
+        struct notedata* note = NotesFindById(list, ids[i], NULL);
+
+        if (note != NULL)
+            note->remind_at = 0;
+    }
+
+    return numPopped;
+}
+
+// saves the names of the tags set in the bitmap
+static void WriteTagList(const struct notelist* list, FILE* fp, const struct tagbitmap* tags)
+{
+    uint32_t count = 0;
+    for (uint32_t tag = 0; tag < list->tags.numTags; tag++)
+        count += TagBitmapTest(tags, tag);
+
+    fwrite(&count, sizeof(count), 1, fp);
+
+    for (uint32_t tag = 0; tag < list->tags.numTags; tag++)
+    {
+        if (!TagBitmapTest(tags, tag))
+            continue;
+
+        uint32_t len = strlen(list->tags.names[tag]);
+        fwrite(&len, sizeof(len), 1, fp);
+        fwrite(list->tags.names[tag], sizeof(char), len, fp);
+    }
+}
+
+// reads a list of tag names written by WriteTagList
+static int ReadTagList(struct notelist* list, FILE* fp, struct tagbitmap* tags)
+{
+    uint32_t count;
+    if (fread(&count, sizeof(count), 1, fp) != 1)
+        return 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        char name[TAG_MAX_LENGTH];
+        uint32_t len = 0;
+
+        if (fread(&len, sizeof(len), 1, fp) != 1 || len > TAG_MAX_LENGTH)
+            return 0;
+
+        if (fread(name, sizeof(char), len, fp) != len)
+            return 0;
+
+        int tag = TagIndexIntern(&list->tags, name, len);
+        if (tag >= 0)
+            TagBitmapSet(tags, tag, 1);
+    }
+
+    return 1;
+}
+
+int NotesLoad(struct notelist* list, FILE* fp)
+{
+    uint32_t numNotes;
+
+    // read the header - older files start directly with the number of notes
+    uint32_t version = 0;
+    if (fread(&numNotes, sizeof(numNotes), 1, fp) != 1)
+        return 0;
+
+    if (numNotes == NOTES_FILE_MAGIC)
+    {
+        if (fread(&version, sizeof(version), 1, fp) != 1)
+            return 0;
+
+        // a newer build may have changed the layout - don't misread it
+        if (version == 0 || version > NOTES_FILE_VERSION)
+            return 0;
+
+        // read number of notes saved
+        if (fread(&numNotes, sizeof(numNotes), 1, fp) != 1)
+            return 0;
+    }
+
+    // read default font
+    if (fread(&list->default_font, sizeof(list->default_font), 1, fp) != 1)
+        return 0;
+
+    // read color scheme
+    if (fread(&list->default_color_post, sizeof(list->default_color_post), 1, fp) != 1)
+        return 0;
+
+    if (fread(&list->default_color_text, sizeof(list->default_color_text), 1, fp) != 1)
+        return 0;
+
+    // alloc space for all the notes and then read each one from the file
+    if ((list->notes = (struct notedata*)calloc(sizeof(struct notedata), numNotes)) == NULL)
+        return 0;
+
+    for (uint32_t noteIndex = 0; noteIndex < numNotes; noteIndex++)
+    {
+        struct notedata* note = &list->notes[noteIndex];
+
+        uint32_t len = 0;
+
+        // how long is the text?
+        if (fread(&len, sizeof(len), 1, fp) != 1)
+            break;
+
+        // get placement data - position and size
+        if (fread(&note->x, sizeof(note->x), 1, fp) != 1)
+            break;
+
+        if (fread(&note->y, sizeof(note->y), 1, fp) != 1)
+            break;
+
+        if (fread(&note->w, sizeof(note->w), 1, fp) != 1)
+            break;
+
+        if (fread(&note->h, sizeof(note->h), 1, fp) != 1)
+            break;
+
+        // read font info
+        if (fread(&note->font, sizeof(note->font), 1, fp) != 1)
+            break;
+
+        // read color scheme
+        if (fread(&note->color_post, sizeof(note->color_post), 1, fp) != 1)
+            break;
+
+        if (fread(&note->color_text, sizeof(note->color_text), 1, fp) != 1)
+            break;
+
+        // read reminder
+        uint64_t remind_at = 0;
+        if (version >= 1 && fread(&remind_at, sizeof(remind_at), 1, fp) != 1)
+            break;
+
+        // alloc space for the text and then read it
+        if ((note->text = (char*)calloc(sizeof(char), len + 1)) == NULL)
+            break;
+
+        if (fread(note->text, sizeof(char), len, fp) != len)
+        {
+            free(note->text);
+            break;
+        }
+
+        if (!NotesAssignId(list, noteIndex))
+        {
+            free(note->text);
+            break;
+        }
+
+        // only the notes read completely are kept
+        list->numNotes = noteIndex + 1;
+        TagIndexUpdateNote(&list->tags, note->id, note->text, 1);
+
+        // reminders already due fire as soon as the timer is armed
+        if (remind_at != 0)
+            NotesSetReminder(list, note, remind_at);
+    }
+
+    // read tag filter
+    if (version >= 2 && list->numNotes == numNotes)
+    {
+        if (!ReadTagList(list, fp, &list->filter.required) || !ReadTagList(list, fp, &list->filter.excluded))
+            TagFilterFree(&list->filter);
+    }
+
+    return 1;
+}
+
+int NotesSave(const struct notelist* list, FILE* fp)
+{
+    // write header
+    const uint32_t magic = NOTES_FILE_MAGIC;
+    const uint32_t version = NOTES_FILE_VERSION;
+    fwrite(&magic, sizeof(magic), 1, fp);
+    fwrite(&version, sizeof(version), 1, fp);
+
+    // write number of entries
+    fwrite(&list->numNotes, sizeof(list->numNotes), 1, fp);
+
+    // save default font
+    fwrite(&list->default_font, sizeof(list->default_font), 1, fp);
+
+    // save color scheme
+    fwrite(&list->default_color_post, sizeof(list->default_color_post), 1, fp);
+    fwrite(&list->default_color_text, sizeof(list->default_color_text), 1, fp);
+
+    // write the entries
+    for (uint32_t noteIndex = 0; noteIndex < list->numNotes; noteIndex++)
+    {
+        const struct notedata* note = &list->notes[noteIndex];
+
+        uint32_t len = 0;
+
+        if (note->text != NULL)
+            len = strlen(note->text);
+
+        // write the length of the text in this entry
+        fwrite(&len, sizeof(len), 1, fp);
+
+        // write position and size
+        fwrite(&note->x, sizeof(note->x), 1, fp);
+        fwrite(&note->y, sizeof(note->y), 1, fp);
+        fwrite(&note->w, sizeof(note->w), 1, fp);
+        fwrite(&note->h, sizeof(note->h), 1, fp);
+
+        // write font info
+        fwrite(&note->font, sizeof(note->font), 1, fp);
+
+        // write color scheme
+        fwrite(&note->color_post, sizeof(note->color_post), 1, fp);
+        fwrite(&note->color_text, sizeof(note->color_text), 1, fp);
+
+        // write reminder
+        fwrite(&note->remind_at, sizeof(note->remind_at), 1, fp);
+
+        // write the actual text
+        if (note->text != NULL)
+            fwrite(note->text, sizeof(note->text[0]), len, fp);
+    }
+
+    // write tag filter
+    WriteTagList(list, fp, &list->filter.required);
+    WriteTagList(list, fp, &list->filter.excluded);
+
+    return !ferror(fp);
+}
@@ -0,0 +1,108 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+#ifndef NOTES_H
+#define NOTES_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "reminder.h"
+#include "tags.h"
+
+// notes file header - files without it were written before the format was versioned
+#define NOTES_FILE_MAGIC    0x74497450 // "PtIt"
+#define NOTES_FILE_VERSION  2
+
+// marks an id that belongs to no note
+#define NOTE_NONE 0xFFFFFFFF
+
+// same layout as the (ansi) LOGFONT of windows, which is how fonts are stored in the notes file
+struct notefont
+{
+    int32_t height;
+    int32_t width;
+    int32_t escapement;
+    int32_t orientation;
+    int32_t weight;
+    uint8_t italic;
+    uint8_t underline;
+    uint8_t strikeOut;
+    uint8_t charSet;
+    uint8_t outPrecision;
+    uint8_t clipPrecision;
+    uint8_t quality;
+    uint8_t pitchAndFamily;
+    char faceName[32];
+};
+
+// APP SAVED DATA
+// data that gets saved on disk to be persistent
+struct notedata
+{
+    void* window;       // handles owned by the app (HWND and HFONT on windows) - not saved
+    void* hFont;
+    int32_t x, y, w, h;
+    struct notefont font;
+    uint32_t color_post;
+    uint32_t color_text;
+    char *text;
+    uint64_t remind_at; // milliseconds since the unix epoch - zero when there is no reminder
+    uint32_t id;        // unique key of the note in this session, used by the reminder queue and the tags
+};
+
+struct notelist
+{
+    uint32_t numNotes;
+    uint32_t default_color_post;
+    uint32_t default_color_text;
+    struct notefont default_font;
+    struct notedata* notes;
+    struct reminderqueue reminders;
+    struct tagindex tags;
+    struct tagfilter filter; // which notes are shown, saved in the file
+
+    uint32_t nextNoteId;
+    uint32_t* indexById;     // position in the list of each note id, or NOTE_NONE
+    uint32_t numIds;
+};
+
+// prepares an empty list - the defaults for new notes are left as they are
+void NotesInit(struct notelist* list, reminder_clock clock, void* clockContext);
+void NotesFree(struct notelist* list);
+
+// appends a note with the default colors and font - returns NULL on failure
+struct notedata* NotesAdd(struct notelist* list);
+void NotesDelete(struct notelist* list, uint32_t index);
+struct notedata* NotesFindById(const struct notelist* list, uint32_t id, uint32_t* out_index);
+
+// replaces the text of the note while it is edited, taking ownership of the buffer - matches only the tags that already exist
+int NotesSetText(struct notelist* list, struct notedata* note, char* text);
+
+// picks up the new #tags of a note once the user is done editing it
+int NotesUpdateTags(struct notelist* list, struct notedata* note);
+
+// sets (or clears, when due is zero) the reminder of a note
+int NotesSetReminder(struct notelist* list, struct notedata* note, uint64_t due);
+
+// takes up to maxIds due reminders out of the queue, clearing them from their notes - the ids are written to the list
+uint32_t NotesPopDueReminders(struct notelist* list, uint32_t* ids, uint32_t maxIds);
+
+// reads the notes file into an empty list, or writes the list to it
+int NotesLoad(struct notelist* list, FILE* fp);
+int NotesSave(const struct notelist* list, FILE* fp);
+
+#endif // NOTES_H
@@ -0,0 +1,200 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+#include <stdlib.h>
+#include "reminder.h"
+
+void ReminderInit(struct reminderqueue* queue, reminder_clock clock, void* clockContext)
+{
+    queue->heap = NULL;
+    queue->count = 0;
+    queue->capacity = 0;
+    queue->position = NULL;
+    queue->numIds = 0;
+    queue->clock = clock;
+    queue->clockContext = clockContext;
+}
+
+void ReminderFree(struct reminderqueue* queue)
+{
+    free(queue->heap);
+    free(queue->position);
+    ReminderInit(queue, queue->clock, queue->clockContext);
+}
+
+// places the entry at the given heap slot and keeps the id lookup in sync
+static void ReminderPlace(struct reminderqueue* queue, uint32_t index, struct reminder entry)
+{
+    queue->heap[index] = entry;
+    queue->position[entry.id] = index;
+}
+
+static void ReminderSiftUp(struct reminderqueue* queue, uint32_t index)
+{
+    struct reminder entry = queue->heap[index];
+
+    while (index > 0)
+    {
+        uint32_t parent = (index - 1) / 2;
+
+        if (queue->heap[parent].due <= entry.due)
+            break;
+
+        ReminderPlace(queue, index, queue->heap[parent]);
+        index = parent;
+    }
+
+    ReminderPlace(queue, index, entry);
+}
+
+static void ReminderSiftDown(struct reminderqueue* queue, uint32_t index)
+{
+    struct reminder entry = queue->heap[index];
+
+    for (;;)
+    {
+        uint32_t child = 2 * index + 1;
+
+        if (child >= queue->count)
+            break;
+
+        if (child + 1 < queue->count && queue->heap[child + 1].due < queue->heap[child].due)
+            child++;
+
+        if (entry.due <= queue->heap[child].due)
+            break;
+
+        ReminderPlace(queue, index, queue->heap[child]);
+        index = child;
+    }
+
+    ReminderPlace(queue, index, entry);
+}
+
+// takes the entry at the given heap slot out of the queue
+static void ReminderRemoveAt(struct reminderqueue* queue, uint32_t index)
+{
+    queue->position[queue->heap[index].id] = REMINDER_NONE;
+    queue->count--;
+
+    if (index == queue->count)
+        return;
+
+    // fill the gap with the last entry and restore the heap order in whichever direction it is broken
+    ReminderPlace(queue, index, queue->heap[queue->count]);
+
+    if (index > 0 && queue->heap[index].due < queue->heap[(index - 1) / 2].due)
+        ReminderSiftUp(queue, index);
+    else
+        ReminderSiftDown(queue, index);
+}
+
+int ReminderSchedule(struct reminderqueue* queue, uint32_t id, uint64_t due)
+{
+    if (id == REMINDER_NONE)
+        return 0;
+
+    // grow the id lookup table to cover this id
+    if (id >= queue->numIds)
+    {
+        uint32_t newNumIds = (queue->numIds == 0) ? 64 : queue->numIds;
+        while (newNumIds <= id)
+            newNumIds = (newNumIds > 0x7FFFFFFF) ? REMINDER_NONE : newNumIds * 2;
+
+        uint32_t* new_position = (uint32_t*)realloc(queue->position, sizeof(uint32_t) * newNumIds);
+        if (new_position == NULL)
+            return 0;
+
+        for (uint32_t i = queue->numIds; i < newNumIds; i++)
+            new_position[i] = REMINDER_NONE;
+
+        queue->position = new_position;
+        queue->numIds = newNumIds;
+    }
+
+    // already pending - just move it to the new time
+    uint32_t index = queue->position[id];
+    if (index != REMINDER_NONE)
+    {
+        uint64_t oldDue = queue->heap[index].due;
+        queue->heap[index].due = due;
+
+        if (due < oldDue)
+            ReminderSiftUp(queue, index);
+        else
+            ReminderSiftDown(queue, index);
+
+        return 1;
+    }
+
+    // grow the heap if it is full
+    if (queue->count == queue->capacity)
+    {
+        uint32_t newCapacity = (queue->capacity == 0) ? 64 : queue->capacity * 2;
+
+        struct reminder* new_heap = (struct reminder*)realloc(queue->heap, sizeof(struct reminder) * newCapacity);
+        if (new_heap == NULL)
+            return 0;
+
+        queue->heap = new_heap;
+        queue->capacity = newCapacity;
+    }
+
+    ReminderPlace(queue, queue->count, (struct reminder) { .due = due, .id = id });
+    queue->count++;
+    ReminderSiftUp(queue, queue->count - 1);
+
+    return 1;
+}
+
+void ReminderCancel(struct reminderqueue* queue, uint32_t id)
+{
+    if (!ReminderIsScheduled(queue, id))
+        return;
+
+    ReminderRemoveAt(queue, queue->position[id]);
+}
+
+int ReminderIsScheduled(const struct reminderqueue* queue, uint32_t id)
+{
+    return (id < queue->numIds) && (queue->position[id] != REMINDER_NONE);
+}
+
+int ReminderNext(const struct reminderqueue* queue, uint64_t* out_due)
+{
+    if (queue->count == 0)
+        return 0;
+
+    if (out_due != NULL)
+        *out_due = queue->heap[0].due;
+
+    return 1;
+}
+
+uint32_t ReminderPopDue(struct reminderqueue* queue, uint32_t* ids, uint32_t maxIds)
+{
+    uint64_t now = queue->clock(queue->clockContext);
+    uint32_t numPopped = 0;
+
+    while (numPopped < maxIds && queue->count > 0 && queue->heap[0].due <= now)
+    {
+        ids[numPopped++] = queue->heap[0].id;
+        ReminderRemoveAt(queue, 0);
+    }
+
+    return numPopped;
+}
@@ -0,0 +1,67 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+#ifndef REMINDER_H
+#define REMINDER_H
+
+#include <stdint.h>
+
+// marks an id that currently has no pending reminder
+#define REMINDER_NONE 0xFFFFFFFF
+
+// returns the current time in the same units used for the due times (milliseconds since the unix epoch in the app)
+typedef uint64_t (*reminder_clock)(void* context);
+
+struct reminder
+{
+    uint64_t due;   // absolute time when the reminder fires
+    uint32_t id;    // note that owns the reminder
+};
+
+// pending reminders of all notes, kept in a binary min-heap ordered by due time
+// so that a single timer armed for the earliest entry is enough to serve all of them
+struct reminderqueue
+{
+    struct reminder* heap;
+    uint32_t count;
+    uint32_t capacity;
+
+    uint32_t* position; // heap index of each id, or REMINDER_NONE - allows O(log n) cancel
+    uint32_t numIds;
+
+    reminder_clock clock;
+    void* clockContext;
+};
+
+void ReminderInit(struct reminderqueue* queue, reminder_clock clock, void* clockContext);
+void ReminderFree(struct reminderqueue* queue);
+
+// inserts a reminder for the id, or moves the existing one to the new due time
+int ReminderSchedule(struct reminderqueue* queue, uint32_t id, uint64_t due);
+
+// removes the pending reminder of the id (if any)
+void ReminderCancel(struct reminderqueue* queue, uint32_t id);
+
+int ReminderIsScheduled(const struct reminderqueue* queue, uint32_t id);
+
+// gets the due time of the earliest reminder - returns 0 when nothing is pending
+int ReminderNext(const struct reminderqueue* queue, uint64_t* out_due);
+
+// reads the clock once and removes up to maxIds reminders that are due, writing their ids to the list
+uint32_t ReminderPopDue(struct reminderqueue* queue, uint32_t* ids, uint32_t maxIds);
+
+#endif // REMINDER_H
@@ -5,7 +5,14 @@
 #define MENU_ITEM_TEXT_COLOR_F  500
 #define MENU_ITEM_BACK_COLOR    599
 #define MENU_ITEM_BACK_COLOR_F  600
+#define MENU_ITEM_REMIND        699
+#define MENU_ITEM_REMIND_F      700
+#define MENU_ITEM_TAG           799
+#define MENU_ITEM_TAG_REQUIRE_F 1000
+#define MENU_ITEM_TAG_EXCLUDE_F 2000
 #define MENU_ITEM_CLOSE         202
 #define MENU_ITEM_REPAINT       203
 #define MENU_ITEM_FONT          204
 #define MENU_ITEM_SIZE          205
+#define MENU_ITEM_REMIND_CLEAR  206
+#define MENU_ITEM_TAG_CLEAR     207
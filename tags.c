@@ -0,0 +1,420 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "tags.h"
+
+void TagBitmapInit(struct tagbitmap* bitmap)
+{
+    bitmap->count = 0;
+    bitmap->capacity = 0;
+    bitmap->keys = NULL;
+    bitmap->words = NULL;
+}
+
+void TagBitmapFree(struct tagbitmap* bitmap)
+{
+    free(bitmap->keys);
+    free(bitmap->words);
+    TagBitmapInit(bitmap);
+}
+
+// makes room for at least the given number of words
+static int TagBitmapReserve(struct tagbitmap* bitmap, uint32_t capacity)
+{
+    if (capacity <= bitmap->capacity)
+        return 1;
+
+    uint32_t newCapacity = (bitmap->capacity == 0) ? 4 : bitmap->capacity;
+    while (newCapacity < capacity)
+        newCapacity *= 2;
+
+    uint32_t* new_keys = (uint32_t*)realloc(bitmap->keys, sizeof(uint32_t) * newCapacity);
+    if (new_keys == NULL)
+        return 0;
+
+    bitmap->keys = new_keys;
+
+    uint64_t* new_words = (uint64_t*)realloc(bitmap->words, sizeof(uint64_t) * newCapacity);
+    if (new_words == NULL)
+        return 0;
+
+    bitmap->words = new_words;
+    bitmap->capacity = newCapacity;
+
+    return 1;
+}
+
+// position of the first stored word whose key is not less than the given one
+static uint32_t TagBitmapLowerBound(const struct tagbitmap* bitmap, uint32_t key)
+{
+    uint32_t first = 0;
+    uint32_t last = bitmap->count;
+
+    while (first < last)
+    {
+        uint32_t middle = first + (last - first) / 2;
+
+        if (bitmap->keys[middle] < key)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first;
+}
+
+int TagBitmapSet(struct tagbitmap* bitmap, uint32_t bit, int value)
+{
+    uint32_t key = bit / 64;
+    uint64_t mask = (uint64_t)1 << (bit % 64);
+    uint32_t pos = TagBitmapLowerBound(bitmap, key);
+    int bFound = (pos < bitmap->count && bitmap->keys[pos] == key);
+
+    if (value)
+    {
+        if (bFound)
+        {
+            bitmap->words[pos] |= mask;
+            return 1;
+        }
+
+        // insert a new word to hold the bit
+        if (!TagBitmapReserve(bitmap, bitmap->count + 1))
+            return 0;
+
+        memmove(&bitmap->keys[pos + 1], &bitmap->keys[pos], sizeof(uint32_t) * (bitmap->count - pos));
+        memmove(&bitmap->words[pos + 1], &bitmap->words[pos], sizeof(uint64_t) * (bitmap->count - pos));
+
+        bitmap->keys[pos] = key;
+        bitmap->words[pos] = mask;
+        bitmap->count++;
+    }
+    else if (bFound)
+    {
+        bitmap->words[pos] &= ~mask;
+
+        // drop words that became empty so the bitmap stays compressed
+        if (bitmap->words[pos] == 0)
+        {
+            bitmap->count--;
+            memmove(&bitmap->keys[pos], &bitmap->keys[pos + 1], sizeof(uint32_t) * (bitmap->count - pos));
+            memmove(&bitmap->words[pos], &bitmap->words[pos + 1], sizeof(uint64_t) * (bitmap->count - pos));
+        }
+    }
+
+    return 1;
+}
+
+int TagBitmapTest(const struct tagbitmap* bitmap, uint32_t bit)
+{
+    uint32_t key = bit / 64;
+    uint32_t pos = TagBitmapLowerBound(bitmap, key);
+
+    if (pos >= bitmap->count || bitmap->keys[pos] != key)
+        return 0;
+
+    return (bitmap->words[pos] >> (bit % 64)) & 1;
+}
+
+int TagBitmapIsEmpty(const struct tagbitmap* bitmap)
+{
+    return bitmap->count == 0;
+}
+
+int TagBitmapCopy(struct tagbitmap* out, const struct tagbitmap* a)
+{
+    if (!TagBitmapReserve(out, a->count))
+        return 0;
+
+    memcpy(out->keys, a->keys, sizeof(uint32_t) * a->count);
+    memcpy(out->words, a->words, sizeof(uint64_t) * a->count);
+    out->count = a->count;
+
+    return 1;
+}
+
+// appends a word to the output of a set operation, skipping empty ones
+static void TagBitmapAppend(struct tagbitmap* out, uint32_t key, uint64_t word)
+{
+    if (word == 0)
+        return;
+
+    out->keys[out->count] = key;
+    out->words[out->count] = word;
+    out->count++;
+}
+
+int TagBitmapAnd(struct tagbitmap* out, const struct tagbitmap* a, const struct tagbitmap* b)
+{
+    out->count = 0;
+    if (!TagBitmapReserve(out, (a->count < b->count) ? a->count : b->count))
+        return 0;
+
+    uint32_t i = 0, j = 0;
+    while (i < a->count && j < b->count)
+    {
+        if (a->keys[i] < b->keys[j])
+            i++;
+        else if (a->keys[i] > b->keys[j])
+            j++;
+        else
+        {
+            TagBitmapAppend(out, a->keys[i], a->words[i] & b->words[j]);
+            i++;
+            j++;
+        }
+    }
+
+    return 1;
+}
+
+int TagBitmapAndNot(struct tagbitmap* out, const struct tagbitmap* a, const struct tagbitmap* b)
+{
+    out->count = 0;
+    if (!TagBitmapReserve(out, a->count))
+        return 0;
+
+    uint32_t i = 0, j = 0;
+    while (i < a->count)
+    {
+        if (j >= b->count || a->keys[i] < b->keys[j])
+        {
+            TagBitmapAppend(out, a->keys[i], a->words[i]);
+            i++;
+        }
+        else if (a->keys[i] > b->keys[j])
+            j++;
+        else
+        {
+            TagBitmapAppend(out, a->keys[i], a->words[i] & ~b->words[j]);
+            i++;
+            j++;
+        }
+    }
+
+    return 1;
+}
+
+void TagIndexInit(struct tagindex* index)
+{
+    index->numTags = 0;
+    index->capacity = 0;
+    index->names = NULL;
+    index->notes = NULL;
+    TagBitmapInit(&index->all);
+}
+
+void TagIndexFree(struct tagindex* index)
+{
+    for (uint32_t tag = 0; tag < index->numTags; tag++)
+    {
+        free(index->names[tag]);
+        TagBitmapFree(&index->notes[tag]);
+    }
+
+    free(index->names);
+    free(index->notes);
+    TagBitmapFree(&index->all);
+    TagIndexInit(index);
+}
+
+int TagIndexFind(const struct tagindex* index, const char* name, uint32_t len)
+{
+    // tags are few - a linear search is enough
+    for (uint32_t tag = 0; tag < index->numTags; tag++)
+    {
+        if (strlen(index->names[tag]) == len && strncasecmp(index->names[tag], name, len) == 0)
+            return tag;
+    }
+
+    return -1;
+}
+
+int TagIndexIntern(struct tagindex* index, const char* name, uint32_t len)
+{
+    if (len == 0 || len > TAG_MAX_LENGTH)
+        return -1;
+
+    int existing = TagIndexFind(index, name, len);
+    if (existing >= 0)
+        return existing;
+
+    // grow the list of tags if it is full
+    if (index->numTags == index->capacity)
+    {
+        uint32_t newCapacity = (index->capacity == 0) ? 16 : index->capacity * 2;
+
+        char** new_names = (char**)realloc(index->names, sizeof(char*) * newCapacity);
+        if (new_names == NULL)
+            return -1;
+
+        index->names = new_names;
+
+        struct tagbitmap* new_notes = (struct tagbitmap*)realloc(index->notes, sizeof(struct tagbitmap) * newCapacity);
+        if (new_notes == NULL)
+            return -1;
+
+        index->notes = new_notes;
+        index->capacity = newCapacity;
+    }
+
+    // names are kept in lower case
+    char* new_name = (char*)calloc(sizeof(char), len + 1);
+    if (new_name == NULL)
+        return -1;
+
+    for (uint32_t i = 0; i < len; i++)
+        new_name[i] = tolower((unsigned char)name[i]);
+
+    index->names[index->numTags] = new_name;
+    TagBitmapInit(&index->notes[index->numTags]);
+
+    return index->numTags++;
+}
+
+static int IsTagChar(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '-';
+}
+
+int TagIndexUpdateNote(struct tagindex* index, uint32_t id, const char* text, int bCreate)
+{
+    struct tagbitmap present; // tag indices found in the text
+    TagBitmapInit(&present);
+
+    int bOk = TagBitmapSet(&index->all, id, 1);
+
+    // a tag is a '#' at the start of a word followed by letters, digits, '_' or '-'
+    for (const char* c = text; bOk && c != NULL && *c != '\0'; c++)
+    {
+        if (*c != '#' || (c != text && !isspace((unsigned char)c[-1])))
+            continue;
+
+        const char* name = c + 1;
+        uint32_t len = 0;
+
+        while (IsTagChar(name[len]))
+            len++;
+
+        int tag = bCreate ? TagIndexIntern(index, name, len) : TagIndexFind(index, name, len);
+        if (tag >= 0)
+            bOk = TagBitmapSet(&present, tag, 1);
+
+        c = name + len - 1;
+    }
+
+    // every tag gets the bit of this note set or cleared
+    for (uint32_t tag = 0; bOk && tag < index->numTags; tag++)
+        bOk = TagBitmapSet(&index->notes[tag], id, TagBitmapTest(&present, tag));
+
+    TagBitmapFree(&present);
+
+    return bOk;
+}
+
+void TagIndexRemoveNote(struct tagindex* index, uint32_t id)
+{
+    for (uint32_t tag = 0; tag < index->numTags; tag++)
+        TagBitmapSet(&index->notes[tag], id, 0);
+
+    TagBitmapSet(&index->all, id, 0);
+}
+
+void TagFilterInit(struct tagfilter* filter)
+{
+    TagBitmapInit(&filter->required);
+    TagBitmapInit(&filter->excluded);
+}
+
+void TagFilterFree(struct tagfilter* filter)
+{
+    TagBitmapFree(&filter->required);
+    TagBitmapFree(&filter->excluded);
+}
+
+int TagFilterIsEmpty(const struct tagfilter* filter)
+{
+    return TagBitmapIsEmpty(&filter->required) && TagBitmapIsEmpty(&filter->excluded);
+}
+
+int TagIndexMatches(const struct tagindex* index, const struct tagfilter* filter, uint32_t id)
+{
+    if (!TagBitmapTest(&index->all, id))
+        return 0;
+
+    // the note must have every required tag and none of the excluded ones
+    for (int bExclude = 0; bExclude <= 1; bExclude++)
+    {
+        const struct tagbitmap* tags = bExclude ? &filter->excluded : &filter->required;
+
+        for (uint32_t w = 0; w < tags->count; w++)
+        {
+            for (uint64_t word = tags->words[w]; word != 0; word &= word - 1)
+            {
+                uint32_t tag = tags->keys[w] * 64 + __builtin_ctzll(word);
+                int bHasTag = (tag < index->numTags) && TagBitmapTest(&index->notes[tag], id);
+
+                if (bHasTag == bExclude)
+                    return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+int TagIndexQuery(const struct tagindex* index, const struct tagfilter* filter, struct tagbitmap* out)
+{
+    static const struct tagbitmap empty = { 0 };
+
+    struct tagbitmap scratch;
+    TagBitmapInit(&scratch);
+
+    int bOk = TagBitmapCopy(out, &index->all);
+
+    // walk the set bits of both halves of the filter, narrowing the result one tag at a time
+    for (int bExclude = 0; bExclude <= 1; bExclude++)
+    {
+        const struct tagbitmap* tags = bExclude ? &filter->excluded : &filter->required;
+
+        for (uint32_t w = 0; bOk && w < tags->count; w++)
+        {
+            for (uint64_t word = tags->words[w]; bOk && word != 0; word &= word - 1)
+            {
+                uint32_t tag = tags->keys[w] * 64 + __builtin_ctzll(word);
+                const struct tagbitmap* notes = (tag < index->numTags) ? &index->notes[tag] : &empty;
+
+                if (bExclude)
+                    bOk = TagBitmapAndNot(&scratch, out, notes);
+                else
+                    bOk = TagBitmapAnd(&scratch, out, notes);
+
+                // the result of this step becomes the input of the next
+                struct tagbitmap swap = *out;
+                *out = scratch;
+                scratch = swap;
+            }
+        }
+    }
+
+    TagBitmapFree(&scratch);
+
+    return bOk;
+}
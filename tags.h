@@ -0,0 +1,89 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+#ifndef TAGS_H
+#define TAGS_H
+
+#include <stdint.h>
+
+// longest tag name, not counting the leading '#'
+#define TAG_MAX_LENGTH 32
+
+// compressed set of bits: only the 64-bit words that have any bit set are stored, sorted by their key (bit / 64)
+// a tag used by a handful of notes costs a few words no matter how many notes exist
+struct tagbitmap
+{
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* keys;
+    uint64_t* words;
+};
+
+void TagBitmapInit(struct tagbitmap* bitmap);
+void TagBitmapFree(struct tagbitmap* bitmap);
+int TagBitmapSet(struct tagbitmap* bitmap, uint32_t bit, int value);
+int TagBitmapTest(const struct tagbitmap* bitmap, uint32_t bit);
+int TagBitmapIsEmpty(const struct tagbitmap* bitmap);
+
+// set operations - out must not be one of the operands
+int TagBitmapCopy(struct tagbitmap* out, const struct tagbitmap* a);
+int TagBitmapAnd(struct tagbitmap* out, const struct tagbitmap* a, const struct tagbitmap* b);
+int TagBitmapAndNot(struct tagbitmap* out, const struct tagbitmap* a, const struct tagbitmap* b);
+
+// every tag seen in the notes, each with the bitmap of the note ids that carry it
+struct tagindex
+{
+    uint32_t numTags;
+    uint32_t capacity;
+    char** names;
+    struct tagbitmap* notes;
+    struct tagbitmap all; // every live note id
+};
+
+// show the notes that have all the required tags and none of the excluded ones
+// both are bitmaps of tag indices, e.g. "work AND NOT done" requires work and excludes done
+struct tagfilter
+{
+    struct tagbitmap required;
+    struct tagbitmap excluded;
+};
+
+void TagIndexInit(struct tagindex* index);
+void TagIndexFree(struct tagindex* index);
+
+// gets the index of a tag by name (case insensitive) - returns -1 if there is no such tag
+int TagIndexFind(const struct tagindex* index, const char* name, uint32_t len);
+
+// gets the index of a tag by name, creating it if needed - returns -1 on failure
+int TagIndexIntern(struct tagindex* index, const char* name, uint32_t len);
+
+// re-reads the #tags found in the text of a note
+// while the text is being typed bCreate is zero, so unfinished words don't become tags - only known tags are matched
+int TagIndexUpdateNote(struct tagindex* index, uint32_t id, const char* text, int bCreate);
+void TagIndexRemoveNote(struct tagindex* index, uint32_t id);
+
+void TagFilterInit(struct tagfilter* filter);
+void TagFilterFree(struct tagfilter* filter);
+int TagFilterIsEmpty(const struct tagfilter* filter);
+
+// checks a single note against the filter
+int TagIndexMatches(const struct tagindex* index, const struct tagfilter* filter, uint32_t id);
+
+// resolves the filter to the bitmap of note ids that pass it
+int TagIndexQuery(const struct tagindex* index, const struct tagfilter* filter, struct tagbitmap* out);
+
+#endif // TAGS_H
@@ -0,0 +1,296 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+// tests of the reminder queue against a fake clock
+//
+// build and run from this folder with:
+//     gcc -std=gnu99 -O2 -I.. -o reminder_test reminder_test.c ../reminder.c && ./reminder_test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "reminder.h"
+
+static int numFailures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); numFailures++; } } while (0)
+
+// the clock reads whatever time the test puts in the context
+static uint64_t FakeClock(void* context)
+{
+    return *(uint64_t*)context;
+}
+
+// every entry is not earlier than its parent and the id lookup points back at it
+static int HeapIsValid(const struct reminderqueue* queue)
+{
+    for (uint32_t i = 0; i < queue->count; i++)
+    {
+        if (i > 0 && queue->heap[i].due < queue->heap[(i - 1) / 2].due)
+            return 0;
+
+        if (queue->position[queue->heap[i].id] != i)
+            return 0;
+    }
+
+    return 1;
+}
+
+static void TestSchedule()
+{
+    uint64_t now = 0;
+    struct reminderqueue queue;
+    ReminderInit(&queue, FakeClock, &now);
+
+    uint64_t due = 0;
+    CHECK(!ReminderNext(&queue, &due));
+
+    CHECK(ReminderSchedule(&queue, 3, 300));
+    CHECK(ReminderSchedule(&queue, 1, 100));
+    CHECK(ReminderSchedule(&queue, 2, 200));
+    CHECK(!ReminderSchedule(&queue, REMINDER_NONE, 50));
+
+    CHECK(queue.count == 3);
+    CHECK(ReminderIsScheduled(&queue, 2));
+    CHECK(!ReminderIsScheduled(&queue, 4));
+    CHECK(!ReminderIsScheduled(&queue, 1000));
+    CHECK(ReminderNext(&queue, &due) && due == 100);
+    CHECK(HeapIsValid(&queue));
+
+    // nothing is due before its time
+    uint32_t ids[4];
+    now = 99;
+    CHECK(ReminderPopDue(&queue, ids, 4) == 0);
+
+    now = 200;
+    CHECK(ReminderPopDue(&queue, ids, 4) == 2);
+    CHECK(ids[0] == 1 && ids[1] == 2);
+    CHECK(!ReminderIsScheduled(&queue, 1));
+    CHECK(ReminderNext(&queue, &due) && due == 300);
+
+    ReminderFree(&queue);
+}
+
+static void TestReschedule()
+{
+    uint64_t now = 0;
+    struct reminderqueue queue;
+    ReminderInit(&queue, FakeClock, &now);
+
+    for (uint32_t id = 0; id < 10; id++)
+        ReminderSchedule(&queue, id, 1000 + id * 100);
+
+    // earlier - moves to the front
+    CHECK(ReminderSchedule(&queue, 7, 10));
+    CHECK(queue.count == 10);
+    CHECK(HeapIsValid(&queue));
+
+    uint64_t due = 0;
+    CHECK(ReminderNext(&queue, &due) && due == 10);
+
+    // later - the next one takes the front
+    CHECK(ReminderSchedule(&queue, 7, 5000));
+    CHECK(queue.count == 10);
+    CHECK(HeapIsValid(&queue));
+    CHECK(ReminderNext(&queue, &due) && due == 1000);
+
+    // the rescheduled id only fires at its new time
+    uint32_t ids[16];
+    now = 1900;
+    CHECK(ReminderPopDue(&queue, ids, 16) == 9);
+    CHECK(ReminderIsScheduled(&queue, 7));
+
+    now = 5000;
+    CHECK(ReminderPopDue(&queue, ids, 16) == 1 && ids[0] == 7);
+
+    ReminderFree(&queue);
+}
+
+static void TestCancel()
+{
+    uint64_t now = 0;
+    struct reminderqueue queue;
+    ReminderInit(&queue, FakeClock, &now);
+
+    for (uint32_t id = 0; id < 15; id++)
+        ReminderSchedule(&queue, id, 100 + id);
+
+    // an entry from the middle of the heap, one from the end and the first one
+    uint32_t middle = queue.heap[5].id;
+    uint32_t last = queue.heap[queue.count - 1].id;
+    uint32_t first = queue.heap[0].id;
+
+    ReminderCancel(&queue, middle);
+    CHECK(!ReminderIsScheduled(&queue, middle));
+    CHECK(queue.count == 14);
+    CHECK(HeapIsValid(&queue));
+
+    ReminderCancel(&queue, last);
+    ReminderCancel(&queue, first);
+    CHECK(queue.count == 12);
+    CHECK(HeapIsValid(&queue));
+
+    // cancelling twice, or an id never scheduled, does nothing
+    ReminderCancel(&queue, middle);
+    ReminderCancel(&queue, 500);
+    CHECK(queue.count == 12);
+
+    uint32_t ids[16];
+    now = 1000;
+    uint32_t numPopped = ReminderPopDue(&queue, ids, 16);
+    CHECK(numPopped == 12);
+
+    for (uint32_t i = 0; i < numPopped; i++)
+        CHECK(ids[i] != middle && ids[i] != last && ids[i] != first);
+
+    ReminderFree(&queue);
+}
+
+static void TestPopDueBatches()
+{
+    uint64_t now = 0;
+    struct reminderqueue queue;
+    ReminderInit(&queue, FakeClock, &now);
+
+    for (uint32_t id = 0; id < 10; id++)
+        ReminderSchedule(&queue, id, 10 + id);
+
+    ReminderSchedule(&queue, 10, 1000); // not due
+
+    // more reminders are due than fit in a batch
+    uint32_t ids[4];
+    uint32_t numTotal = 0;
+    uint64_t lastDue = 0;
+    uint32_t numPopped;
+
+    now = 100;
+    CHECK(ReminderPopDue(&queue, ids, 4) == 4);
+    CHECK(ids[0] == 0 && ids[3] == 3);
+    numTotal += 4;
+
+    while ((numPopped = ReminderPopDue(&queue, ids, 4)) > 0)
+    {
+        CHECK(numPopped <= 4);
+
+        // batches come out in due order
+        for (uint32_t i = 0; i < numPopped; i++)
+        {
+            CHECK(10 + ids[i] >= lastDue);
+            lastDue = 10 + ids[i];
+        }
+
+        numTotal += numPopped;
+    }
+
+    CHECK(numTotal == 10);
+    CHECK(queue.count == 1 && ReminderIsScheduled(&queue, 10));
+
+    ReminderFree(&queue);
+}
+
+static void TestManyPending()
+{
+    const uint32_t numIds = 100000;
+    uint64_t now = 0;
+    struct reminderqueue queue;
+    ReminderInit(&queue, FakeClock, &now);
+
+    uint64_t* due = (uint64_t*)calloc(sizeof(uint64_t), numIds);
+    srand(1);
+
+    for (uint32_t id = 0; id < numIds; id++)
+    {
+        due[id] = 1 + (uint64_t)rand() % 1000000;
+        CHECK(ReminderSchedule(&queue, id, due[id]));
+    }
+
+    // edit some and remove others, as notes do
+    for (uint32_t id = 0; id < numIds; id += 3)
+    {
+        due[id] = 1 + (uint64_t)rand() % 1000000;
+        ReminderSchedule(&queue, id, due[id]);
+    }
+
+    for (uint32_t id = 1; id < numIds; id += 7)
+    {
+        ReminderCancel(&queue, id);
+        due[id] = 0;
+    }
+
+    CHECK(HeapIsValid(&queue));
+
+    // advance the clock and check each fired id was due and nothing due is left behind
+    uint32_t ids[256];
+    uint32_t numPopped;
+    uint32_t numFired = 0;
+    int bOk = 1;
+
+    for (now = 0; now <= 1000000; now += 997)
+    {
+        while ((numPopped = ReminderPopDue(&queue, ids, 256)) > 0)
+        {
+            for (uint32_t i = 0; i < numPopped; i++)
+            {
+                bOk &= (due[ids[i]] != 0 && due[ids[i]] <= now);
+                due[ids[i]] = 0;
+            }
+
+            numFired += numPopped;
+        }
+
+        uint64_t next;
+        if (ReminderNext(&queue, &next))
+            bOk &= (next > now);
+    }
+
+    now = 2000000;
+    while ((numPopped = ReminderPopDue(&queue, ids, 256)) > 0)
+    {
+        for (uint32_t i = 0; i < numPopped; i++)
+            due[ids[i]] = 0;
+
+        numFired += numPopped;
+    }
+
+    for (uint32_t id = 0; id < numIds; id++)
+        bOk &= (due[id] == 0);
+
+    CHECK(bOk);
+    CHECK(queue.count == 0);
+    CHECK(numFired == numIds - (numIds - 1 + 6) / 7);
+
+    free(due);
+    ReminderFree(&queue);
+}
+
+int main()
+{
+    TestSchedule();
+    TestReschedule();
+    TestCancel();
+    TestPopDueBatches();
+    TestManyPending();
+
+    if (numFailures > 0)
+    {
+        printf("%d checks failed\n", numFailures);
+        return 1;
+    }
+
+    printf("All reminder tests passed\n");
+    return 0;
+}
@@ -0,0 +1,360 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+// replays a trace recorded with "PostIt.exe --trace" against a headless model of the notes
+// and reports the latency percentiles, allocations and bytes written for each kind of event
+//
+// linux only (counts allocations through glibc), build from this folder with:
+//     gcc -std=gnu99 -O2 -I.. -o replay replay.c ../notes.c ../reminder.c ../tags.c ../trace.c
+//
+// usage: replay <trace file> [notes file to save to]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "notes.h"
+#include "trace.h"
+
+// ALLOCATION COUNTING
+// replaces the allocator entry points of glibc, so the allocations made by fopen & co. are counted too
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t num, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static uint64_t numAllocs = 0;
+
+void* malloc(size_t size)
+{
+    numAllocs++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size)
+{
+    numAllocs++;
+    return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    numAllocs++;
+    return __libc_realloc(ptr, size);
+}
+
+// HEADLESS MODEL
+// the same list of notes the app keeps, without any windows
+struct replaydata
+{
+    struct notelist notes;
+    const char* filename;
+    uint64_t time;          // wall clock of the event being replayed, in the units of the reminders
+    uint64_t bytesWritten;  // by the last save
+};
+
+struct replaydata replay = { 0 };
+
+// the reminders see the time at which the event being replayed was recorded
+static uint64_t ReplayClock(void* context)
+{
+    (void)context;
+    return replay.time;
+}
+
+// takes the reminders that are due out of the queue, like FireDueReminders in the app
+// the app then traces the cleared reminders and the save, so those are replayed as events of their own
+static uint32_t FireDueReminders()
+{
+    uint32_t ids[256];
+    uint32_t numFired = 0;
+    uint32_t numPopped;
+
+    while ((numPopped = NotesPopDueReminders(&replay.notes, ids, sizeof(ids)/sizeof(ids[0]))) > 0)
+        numFired += numPopped;
+
+    return numFired;
+}
+
+// rewrites the notes file, just like UpdateFile does
+static int SaveNotes()
+{
+    FILE* fp = fopen(replay.filename, "wb+");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error opening notes file to update\n");
+        return 0;
+    }
+
+    int bOk = NotesSave(&replay.notes, fp);
+
+    replay.bytesWritten = ftell(fp);
+    fclose(fp);
+
+    return bOk;
+}
+
+// applies the change recorded in the event to the model - returns 0 if the event does not match the model
+static int ApplyEvent(const struct traceevent* event)
+{
+    uint32_t noteIndex;
+    struct notedata* note = NULL;
+
+    if (event->type == TRACE_SAVE)
+        return SaveNotes();
+
+    if (event->type == TRACE_NOTE_NEW)
+    {
+        // a corrupted trace can name an id that is out of range or already taken
+        if (event->id == NOTE_NONE || NotesFindById(&replay.notes, event->id, NULL) != NULL)
+            return 0;
+
+        replay.notes.nextNoteId = event->id; // keep the ids of the recording so the later events find the note
+        return NotesAdd(&replay.notes) != NULL;
+    }
+
+    // every message starts by looking the note up
+    if ((note = NotesFindById(&replay.notes, event->id, &noteIndex)) == NULL)
+        return 0;
+
+    switch (event->type)
+    {
+        case TRACE_NOTE_DELETE:
+            NotesDelete(&replay.notes, noteIndex);
+        break;
+
+        case TRACE_EDIT_CHANGE:
+        {
+            // rebuild the full text, as the edit control hands it over on EN_CHANGE
+            uint32_t oldLen = (note->text != NULL) ? strlen(note->text) : 0;
+
+            if ((uint64_t)event->prefixLen + event->suffixLen > oldLen)
+                return 0;
+
+            char* new_text = (char*)calloc(sizeof(char), event->prefixLen + event->insertLen + event->suffixLen + 1);
+            if (new_text == NULL)
+                return 0;
+
+            if (note->text != NULL)
+            {
+                memcpy(new_text, note->text, event->prefixLen);
+                memcpy(new_text + event->prefixLen + event->insertLen, note->text + oldLen - event->suffixLen, event->suffixLen);
+            }
+
+            memcpy(new_text + event->prefixLen, event->insert, event->insertLen);
+
+            return NotesSetText(&replay.notes, note, new_text);
+        }
+        break;
+
+        case TRACE_MOVE:
+        case TRACE_SIZE:
+            note->x = event->x;
+            note->y = event->y;
+            note->w = event->w;
+            note->h = event->h;
+        break;
+
+        case TRACE_REMIND:
+            return NotesSetReminder(&replay.notes, note, event->remind_at);
+        break;
+
+        case TRACE_DEACTIVATE:
+        case TRACE_TAGS:
+            return NotesUpdateTags(&replay.notes, note);
+        break;
+
+        default: // activation only looks the note up
+        break;
+    }
+
+    return 1;
+}
+
+// REPORT
+struct eventstats
+{
+    const char* name;
+    uint64_t count;
+    uint64_t capacity;
+    uint64_t* latencies;    // nanoseconds
+    uint64_t allocs;
+    uint64_t bytesWritten;
+};
+
+static struct eventstats stats[] = {
+    { .name = "total" },
+    { .name = "new" },
+    { .name = "delete" },
+    { .name = "edit change" },
+    { .name = "move" },
+    { .name = "size" },
+    { .name = "activate" },
+    { .name = "deactivate" },
+    { .name = "remind" },
+    { .name = "save" },
+    { .name = "tags" },
+    { .name = "fire" },     // batches of reminders that came due, not recorded events
+};
+
+#define STATS_FIRE (TRACE_TAGS + 1)
+
+static int AddSample(struct eventstats* stat, uint64_t latency, uint64_t allocs, uint64_t bytesWritten)
+{
+    if (stat->count == stat->capacity)
+    {
+        uint64_t newCapacity = (stat->capacity == 0) ? 1024 : stat->capacity * 2;
+
+        uint64_t* new_latencies = (uint64_t*)realloc(stat->latencies, sizeof(uint64_t) * newCapacity);
+        if (new_latencies == NULL)
+            return 0;
+
+        stat->latencies = new_latencies;
+        stat->capacity = newCapacity;
+    }
+
+    stat->latencies[stat->count++] = latency;
+    stat->allocs += allocs;
+    stat->bytesWritten += bytesWritten;
+
+    return 1;
+}
+
+static int CompareLatency(const void* a, const void* b)
+{
+    uint64_t la = *(const uint64_t*)a;
+    uint64_t lb = *(const uint64_t*)b;
+
+    return (la > lb) - (la < lb);
+}
+
+// nearest rank percentile of the sorted latencies, in microseconds
+static double Percentile(const struct eventstats* stat, double pct)
+{
+    uint64_t rank = (uint64_t)(pct / 100.0 * (stat->count - 1) + 0.5);
+    return stat->latencies[rank] / 1000.0;
+}
+
+static void PrintStats()
+{
+    printf("%-12s %10s %10s %10s %10s %10s %10s %12s %14s\n", "event", "count", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us", "allocs", "bytes written");
+
+    for (uint32_t i = 0; i < sizeof(stats)/sizeof(stats[0]); i++)
+    {
+        struct eventstats* stat = &stats[i];
+
+        if (stat->count == 0)
+            continue;
+
+        qsort(stat->latencies, stat->count, sizeof(uint64_t), CompareLatency);
+
+        printf("%-12s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %12llu %14llu\n", stat->name, (unsigned long long)stat->count,
+            Percentile(stat, 50), Percentile(stat, 90), Percentile(stat, 99), Percentile(stat, 99.9), Percentile(stat, 100),
+            (unsigned long long)stat->allocs, (unsigned long long)stat->bytesWritten);
+    }
+}
+
+static uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <trace file> [notes file to save to]\n", argv[0]);
+        return 1;
+    }
+
+    struct tracefile trace;
+    if (!TraceOpen(&trace, argv[1]))
+    {
+        fprintf(stderr, "Error reading trace file %s\n", argv[1]);
+        TraceClose(&trace);
+        return 1;
+    }
+
+    if (trace.fontSize != sizeof(struct notefont))
+        fprintf(stderr, "Trace was recorded with fonts of %u bytes, the notes file will differ\n", trace.fontSize);
+
+    replay.filename = (argc > 2) ? argv[2] : "replay.data";
+    NotesInit(&replay.notes, ReplayClock, NULL);
+
+    // replay at full speed, ignoring the recorded timing
+    struct traceevent event;
+    uint64_t numUnmatched = 0;
+    uint64_t startTime = NowNs();
+    int result;
+
+    if (trace.startTime == 0)
+        fprintf(stderr, "Trace has no start time, reminders will not fire\n");
+
+    while ((result = TraceRead(&trace, &event)) > 0)
+    {
+        // fire the reminders that came due up to the time of this event
+        if (trace.startTime != 0)
+        {
+            uint64_t allocsBefore = numAllocs;
+            uint64_t fireStart = NowNs();
+
+            replay.time = trace.startTime + event.time / 1000;
+
+            if (FireDueReminders() > 0)
+                AddSample(&stats[STATS_FIRE], NowNs() - fireStart, numAllocs - allocsBefore, 0);
+        }
+
+        uint64_t allocsBefore = numAllocs;
+        uint64_t eventStart = NowNs();
+
+        replay.bytesWritten = 0;
+
+        if (!ApplyEvent(&event))
+            numUnmatched++;
+
+        uint64_t latency = NowNs() - eventStart;
+        uint64_t allocs = numAllocs - allocsBefore;
+
+        if (event.type < STATS_FIRE)
+            AddSample(&stats[event.type], latency, allocs, replay.bytesWritten);
+
+        AddSample(&stats[0], latency, allocs, replay.bytesWritten);
+    }
+
+    double elapsed = (NowNs() - startTime) / 1e9;
+
+    if (result < 0)
+        fprintf(stderr, "Trace is malformed after %llu events\n", (unsigned long long)stats[0].count);
+
+    if (numUnmatched > 0)
+        fprintf(stderr, "%llu events did not match the notes being replayed\n", (unsigned long long)numUnmatched);
+
+    printf("Replayed %llu events in %.3f s, %u notes at the end\n\n", (unsigned long long)stats[0].count, elapsed, replay.notes.numNotes);
+    PrintStats();
+
+    // cleanup
+    NotesFree(&replay.notes);
+    TraceClose(&trace);
+
+    for (uint32_t i = 0; i < sizeof(stats)/sizeof(stats[0]); i++)
+        free(stats[i].latencies);
+
+    return (result < 0) ? 1 : 0;
+}
@@ -0,0 +1,370 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+// tests of the tag bitmaps, the filter queries and the filter saved in the notes file
+//
+// build and run from this folder with:
+//     gcc -std=gnu99 -O2 -I.. -o tags_test tags_test.c ../tags.c ../notes.c ../reminder.c && ./tags_test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "notes.h"
+#include "tags.h"
+
+static int numFailures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); numFailures++; } } while (0)
+
+static uint64_t FixedClock(void* context)
+{
+    (void)context;
+    return 0;
+}
+
+// keys strictly increasing and no empty word kept
+static int BitmapIsValid(const struct tagbitmap* bitmap)
+{
+    for (uint32_t i = 0; i < bitmap->count; i++)
+    {
+        if (bitmap->words[i] == 0)
+            return 0;
+
+        if (i > 0 && bitmap->keys[i] <= bitmap->keys[i - 1])
+            return 0;
+    }
+
+    return 1;
+}
+
+// the bitmap holds exactly the bits set in the plain array
+static int BitmapEquals(const struct tagbitmap* bitmap, const uint8_t* bits, uint32_t numBits)
+{
+    for (uint32_t bit = 0; bit < numBits; bit++)
+    {
+        if (TagBitmapTest(bitmap, bit) != bits[bit])
+            return 0;
+    }
+
+    return BitmapIsValid(bitmap);
+}
+
+// replaces the text of a note by id
+static void SetText(struct notelist* list, uint32_t id, const char* text)
+{
+    struct notedata* note = NotesFindById(list, id, NULL);
+    NotesSetText(list, note, strdup(text));
+}
+
+static void TestBitmapSet()
+{
+    struct tagbitmap bitmap;
+    TagBitmapInit(&bitmap);
+
+    CHECK(TagBitmapIsEmpty(&bitmap));
+    CHECK(!TagBitmapTest(&bitmap, 0));
+
+    // out of order, in three words
+    CHECK(TagBitmapSet(&bitmap, 200, 1));
+    CHECK(TagBitmapSet(&bitmap, 3, 1));
+    CHECK(TagBitmapSet(&bitmap, 63, 1));
+    CHECK(TagBitmapSet(&bitmap, 100000, 1));
+    CHECK(TagBitmapSet(&bitmap, 3, 1)); // already set
+
+    CHECK(bitmap.count == 3);
+    CHECK(BitmapIsValid(&bitmap));
+    CHECK(TagBitmapTest(&bitmap, 3) && TagBitmapTest(&bitmap, 63) && TagBitmapTest(&bitmap, 200) && TagBitmapTest(&bitmap, 100000));
+    CHECK(!TagBitmapTest(&bitmap, 4) && !TagBitmapTest(&bitmap, 64) && !TagBitmapTest(&bitmap, 99999));
+
+    // clearing a bit in a word that still has others keeps the word
+    CHECK(TagBitmapSet(&bitmap, 3, 0));
+    CHECK(bitmap.count == 3 && !TagBitmapTest(&bitmap, 3) && TagBitmapTest(&bitmap, 63));
+
+    // clearing the last bit of a word removes it
+    CHECK(TagBitmapSet(&bitmap, 63, 0));
+    CHECK(bitmap.count == 2);
+    CHECK(TagBitmapSet(&bitmap, 200, 0));
+    CHECK(bitmap.count == 1 && bitmap.keys[0] == 100000 / 64);
+    CHECK(BitmapIsValid(&bitmap));
+
+    // clearing a bit that isn't set does nothing
+    CHECK(TagBitmapSet(&bitmap, 5000, 0));
+    CHECK(bitmap.count == 1);
+
+    CHECK(TagBitmapSet(&bitmap, 100000, 0));
+    CHECK(TagBitmapIsEmpty(&bitmap));
+
+    TagBitmapFree(&bitmap);
+}
+
+static void TestBitmapOperations()
+{
+    const uint32_t numBits = 20000;
+    uint8_t* bitsA = (uint8_t*)calloc(1, numBits);
+    uint8_t* bitsB = (uint8_t*)calloc(1, numBits);
+    uint8_t* expected = (uint8_t*)calloc(1, numBits);
+
+    struct tagbitmap a, b, out;
+    TagBitmapInit(&a);
+    TagBitmapInit(&b);
+    TagBitmapInit(&out);
+    srand(1);
+
+    // dense in some words, sparse or missing in others, so both operands have words the other lacks
+    for (uint32_t bit = 0; bit < numBits; bit++)
+    {
+        uint32_t word = bit / 64;
+
+        bitsA[bit] = (word % 5 != 0) && (rand() % ((word % 3 == 0) ? 2 : 40) == 0);
+        bitsB[bit] = (word % 7 != 0) && (rand() % ((word % 4 == 0) ? 2 : 40) == 0);
+
+        TagBitmapSet(&a, bit, bitsA[bit]);
+        TagBitmapSet(&b, bit, bitsB[bit]);
+    }
+
+    CHECK(BitmapEquals(&a, bitsA, numBits));
+    CHECK(BitmapEquals(&b, bitsB, numBits));
+
+    for (uint32_t bit = 0; bit < numBits; bit++)
+        expected[bit] = bitsA[bit] && bitsB[bit];
+
+    CHECK(TagBitmapAnd(&out, &a, &b));
+    CHECK(BitmapEquals(&out, expected, numBits));
+
+    for (uint32_t bit = 0; bit < numBits; bit++)
+        expected[bit] = bitsA[bit] && !bitsB[bit];
+
+    CHECK(TagBitmapAndNot(&out, &a, &b));
+    CHECK(BitmapEquals(&out, expected, numBits));
+
+    CHECK(TagBitmapCopy(&out, &b));
+    CHECK(BitmapEquals(&out, bitsB, numBits));
+
+    // with an empty operand
+    struct tagbitmap empty;
+    TagBitmapInit(&empty);
+
+    CHECK(TagBitmapAnd(&out, &a, &empty));
+    CHECK(TagBitmapIsEmpty(&out));
+
+    CHECK(TagBitmapAndNot(&out, &a, &empty));
+    CHECK(BitmapEquals(&out, bitsA, numBits));
+
+    CHECK(TagBitmapAndNot(&out, &empty, &a));
+    CHECK(TagBitmapIsEmpty(&out));
+
+    TagBitmapFree(&empty);
+    TagBitmapFree(&a);
+    TagBitmapFree(&b);
+    TagBitmapFree(&out);
+    free(bitsA);
+    free(bitsB);
+    free(expected);
+}
+
+static void TestQuery()
+{
+    struct notelist list;
+    NotesInit(&list, FixedClock, NULL);
+
+    const char* texts[] = {
+        "plan the #work week",
+        "#work #done",
+        "#Work item\n#urgent",
+        "nothing tagged, not even an#email or #",
+        "#done with #home",
+        "#work-in-progress is another tag",
+    };
+    const uint32_t numTexts = sizeof(texts)/sizeof(texts[0]);
+
+    for (uint32_t i = 0; i < numTexts; i++)
+    {
+        struct notedata* note = NotesAdd(&list);
+        note->text = strdup(texts[i]);
+        NotesUpdateTags(&list, note);
+    }
+
+    CHECK(list.tags.numTags == 5);
+    CHECK(TagIndexFind(&list.tags, "email", 5) < 0);
+
+    int work = TagIndexFind(&list.tags, "WORK", 4); // case insensitive
+    int done = TagIndexFind(&list.tags, "done", 4);
+    CHECK(work >= 0 && done >= 0);
+    CHECK(TagIndexFind(&list.tags, "work-in-progress", 16) >= 0);
+
+    // work AND NOT done
+    struct tagfilter filter;
+    TagFilterInit(&filter);
+    CHECK(TagFilterIsEmpty(&filter));
+
+    TagBitmapSet(&filter.required, work, 1);
+    TagBitmapSet(&filter.excluded, done, 1);
+    CHECK(!TagFilterIsEmpty(&filter));
+
+    struct tagbitmap shown;
+    TagBitmapInit(&shown);
+    CHECK(TagIndexQuery(&list.tags, &filter, &shown));
+
+    const uint8_t expected[] = { 1, 0, 1, 0, 0, 0 };
+    CHECK(BitmapEquals(&shown, expected, numTexts));
+
+    for (uint32_t id = 0; id < numTexts; id++)
+        CHECK(TagIndexMatches(&list.tags, &filter, id) == expected[id]);
+
+    // the empty filter shows every live note
+    struct tagfilter none;
+    TagFilterInit(&none);
+    CHECK(TagIndexQuery(&list.tags, &none, &shown));
+    CHECK(TagBitmapTest(&shown, 3) && TagBitmapTest(&shown, 5));
+    CHECK(TagIndexMatches(&list.tags, &none, 3));
+
+    // an edit that adds #done takes the note out, and a deleted note leaves every result
+    SetText(&list, 0, "plan the #work week, #done");
+    CHECK(!TagIndexMatches(&list.tags, &filter, 0));
+
+    uint32_t noteIndex;
+    NotesFindById(&list, 2, &noteIndex);
+    NotesDelete(&list, noteIndex);
+
+    CHECK(TagIndexQuery(&list.tags, &filter, &shown));
+    CHECK(TagBitmapIsEmpty(&shown));
+    CHECK(TagIndexQuery(&list.tags, &none, &shown));
+    CHECK(!TagBitmapTest(&shown, 2));
+
+    TagBitmapFree(&shown);
+    TagFilterFree(&none);
+    TagFilterFree(&filter);
+    NotesFree(&list);
+}
+
+static void TestPartialWords()
+{
+    struct notelist list;
+    NotesInit(&list, FixedClock, NULL);
+
+    struct notedata* note = NotesAdd(&list);
+    uint32_t id = note->id;
+
+    // typed one key at a time, as EN_CHANGE hands the text over
+    const char* word = "#work";
+    for (uint32_t len = 1; len <= strlen(word); len++)
+    {
+        char* text = strndup(word, len);
+        SetText(&list, id, text);
+        free(text);
+    }
+
+    CHECK(list.tags.numTags == 0);
+
+    // the word is complete when the note loses focus
+    NotesUpdateTags(&list, NotesFindById(&list, id, NULL));
+    CHECK(list.tags.numTags == 1);
+
+    int work = TagIndexFind(&list.tags, "work", 4);
+    CHECK(work >= 0 && TagBitmapTest(&list.tags.notes[work], id));
+
+    // known tags are matched while typing, in this or any other note
+    struct notedata* other = NotesAdd(&list);
+    uint32_t otherId = other->id;
+
+    SetText(&list, otherId, "#wor");
+    CHECK(!TagBitmapTest(&list.tags.notes[work], otherId));
+
+    SetText(&list, otherId, "#work");
+    CHECK(TagBitmapTest(&list.tags.notes[work], otherId));
+
+    SetText(&list, otherId, "#work #ne");
+    SetText(&list, otherId, "#work #new");
+    CHECK(list.tags.numTags == 1);
+
+    // removing a tag from the text clears the bit right away
+    SetText(&list, id, "no tags");
+    CHECK(!TagBitmapTest(&list.tags.notes[work], id));
+
+    NotesFree(&list);
+}
+
+static void TestFilterRoundTrip()
+{
+    struct notelist list;
+    NotesInit(&list, FixedClock, NULL);
+
+    const char* texts[] = { "#work a", "#work #done b", "#home c", "#work #home d" };
+    const uint32_t numTexts = sizeof(texts)/sizeof(texts[0]);
+
+    for (uint32_t i = 0; i < numTexts; i++)
+    {
+        struct notedata* note = NotesAdd(&list);
+        note->text = strdup(texts[i]);
+        NotesUpdateTags(&list, note);
+    }
+
+    TagBitmapSet(&list.filter.required, TagIndexFind(&list.tags, "work", 4), 1);
+    TagBitmapSet(&list.filter.excluded, TagIndexFind(&list.tags, "done", 4), 1);
+    TagBitmapSet(&list.filter.excluded, TagIndexFind(&list.tags, "home", 4), 1);
+
+    FILE* fp = tmpfile();
+    CHECK(fp != NULL);
+    CHECK(NotesSave(&list, fp));
+    rewind(fp);
+
+    // the filter is stored by name, so it survives the tags being interned in another order
+    struct notelist loaded;
+    NotesInit(&loaded, FixedClock, NULL);
+    TagIndexIntern(&loaded.tags, "home", 4);
+
+    CHECK(NotesLoad(&loaded, fp));
+    fclose(fp);
+
+    CHECK(loaded.numNotes == numTexts);
+    CHECK(loaded.tags.numTags == 3);
+
+    int work = TagIndexFind(&loaded.tags, "work", 4);
+    int done = TagIndexFind(&loaded.tags, "done", 4);
+    int home = TagIndexFind(&loaded.tags, "home", 4);
+
+    CHECK(TagBitmapTest(&loaded.filter.required, work) && !TagBitmapTest(&loaded.filter.required, done) && !TagBitmapTest(&loaded.filter.required, home));
+    CHECK(TagBitmapTest(&loaded.filter.excluded, done) && TagBitmapTest(&loaded.filter.excluded, home) && !TagBitmapTest(&loaded.filter.excluded, work));
+
+    for (uint32_t i = 0; i < numTexts; i++)
+        CHECK(TagIndexMatches(&loaded.tags, &loaded.filter, loaded.notes[i].id) == TagIndexMatches(&list.tags, &list.filter, list.notes[i].id));
+
+    CHECK(TagIndexMatches(&loaded.tags, &loaded.filter, loaded.notes[0].id));
+    CHECK(!TagIndexMatches(&loaded.tags, &loaded.filter, loaded.notes[3].id));
+
+    NotesFree(&loaded);
+    NotesFree(&list);
+}
+
+int main()
+{
+    TestBitmapSet();
+    TestBitmapOperations();
+    TestQuery();
+    TestPartialWords();
+    TestFilterRoundTrip();
+
+    if (numFailures > 0)
+    {
+        printf("%d checks failed\n", numFailures);
+        return 1;
+    }
+
+    printf("All tag tests passed\n");
+    return 0;
+}
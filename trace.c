@@ -0,0 +1,282 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+#define TRACE_MAGIC     0x72547450 // "PtTr"
+#define TRACE_VERSION   3 // version 1 had no start time, version 2 no TRACE_TAGS
+
+static void TraceWriteVarint(FILE* fp, uint64_t value)
+{
+    uint8_t bytes[10];
+    int len = 0;
+
+    // 7 bits per byte, high bit set on all but the last one
+    do
+    {
+        bytes[len] = value & 0x7F;
+        value >>= 7;
+
+        if (value != 0)
+            bytes[len] |= 0x80;
+
+        len++;
+    } while (value != 0);
+
+    fwrite(bytes, sizeof(uint8_t), len, fp);
+}
+
+static int TraceReadVarint(FILE* fp, uint64_t* value)
+{
+    *value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = fgetc(fp);
+        if (c == EOF)
+            return 0;
+
+        *value |= (uint64_t)(c & 0x7F) << shift;
+
+        if ((c & 0x80) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+// signed values are zigzag encoded so small negative numbers stay short
+static void TraceWriteSigned(FILE* fp, int32_t value)
+{
+    TraceWriteVarint(fp, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static int TraceReadSigned(FILE* fp, int32_t* value)
+{
+    uint64_t raw;
+    if (!TraceReadVarint(fp, &raw))
+        return 0;
+
+    *value = (int32_t)((uint32_t)(raw >> 1) ^ -(uint32_t)(raw & 1));
+    return 1;
+}
+
+int TraceCreate(struct tracefile* trace, const char* filename, uint32_t fontSize, uint64_t startTime)
+{
+    memset(trace, 0, sizeof(struct tracefile));
+
+    if ((trace->fp = fopen(filename, "wb")) == NULL)
+        return 0;
+
+    const uint32_t magic = TRACE_MAGIC;
+    const uint32_t version = TRACE_VERSION;
+
+    fwrite(&magic, sizeof(magic), 1, trace->fp);
+    fwrite(&version, sizeof(version), 1, trace->fp);
+    fwrite(&fontSize, sizeof(fontSize), 1, trace->fp);
+    fwrite(&startTime, sizeof(startTime), 1, trace->fp);
+
+    trace->fontSize = fontSize;
+    trace->startTime = startTime;
+
+    return 1;
+}
+
+void TraceEvent(struct tracefile* trace, uint8_t type, uint32_t id, uint64_t time)
+{
+    if (trace->fp == NULL)
+        return;
+
+    // times are stored as the difference to the previous event
+    uint64_t delta = (time > trace->lastTime) ? time - trace->lastTime : 0;
+    trace->lastTime += delta;
+
+    fputc(type, trace->fp);
+    TraceWriteVarint(trace->fp, delta);
+    TraceWriteVarint(trace->fp, id);
+}
+
+void TraceText(struct tracefile* trace, uint32_t id, uint64_t time, const char* oldText, const char* newText)
+{
+    if (trace->fp == NULL)
+        return;
+
+    if (oldText == NULL)
+        oldText = "";
+
+    if (newText == NULL)
+        newText = "";
+
+    // typing changes a few chars at a time - only the part between the common prefix and suffix is stored
+    uint32_t oldLen = strlen(oldText);
+    uint32_t newLen = strlen(newText);
+    uint32_t prefixLen = 0;
+    uint32_t suffixLen = 0;
+
+    while (prefixLen < oldLen && prefixLen < newLen && oldText[prefixLen] == newText[prefixLen])
+        prefixLen++;
+
+    while (suffixLen < oldLen - prefixLen && suffixLen < newLen - prefixLen && oldText[oldLen - suffixLen - 1] == newText[newLen - suffixLen - 1])
+        suffixLen++;
+
+    uint32_t insertLen = newLen - prefixLen - suffixLen;
+
+    TraceEvent(trace, TRACE_EDIT_CHANGE, id, time);
+    TraceWriteVarint(trace->fp, prefixLen);
+    TraceWriteVarint(trace->fp, suffixLen);
+    TraceWriteVarint(trace->fp, insertLen);
+    fwrite(newText + prefixLen, sizeof(char), insertLen, trace->fp);
+}
+
+void TracePlacement(struct tracefile* trace, uint8_t type, uint32_t id, uint64_t time, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    if (trace->fp == NULL)
+        return;
+
+    TraceEvent(trace, type, id, time);
+    TraceWriteSigned(trace->fp, x);
+    TraceWriteSigned(trace->fp, y);
+    TraceWriteSigned(trace->fp, w);
+    TraceWriteSigned(trace->fp, h);
+}
+
+void TraceReminder(struct tracefile* trace, uint32_t id, uint64_t time, uint64_t remind_at)
+{
+    if (trace->fp == NULL)
+        return;
+
+    TraceEvent(trace, TRACE_REMIND, id, time);
+    TraceWriteVarint(trace->fp, remind_at);
+}
+
+int TraceOpen(struct tracefile* trace, const char* filename)
+{
+    memset(trace, 0, sizeof(struct tracefile));
+
+    if ((trace->fp = fopen(filename, "rb")) == NULL)
+        return 0;
+
+    uint32_t magic, version;
+
+    if (fread(&magic, sizeof(magic), 1, trace->fp) != 1 || magic != TRACE_MAGIC)
+        return 0;
+
+    if (fread(&version, sizeof(version), 1, trace->fp) != 1 || version < 1 || version > TRACE_VERSION)
+        return 0;
+
+    if (fread(&trace->fontSize, sizeof(trace->fontSize), 1, trace->fp) != 1)
+        return 0;
+
+    if (version >= 2 && fread(&trace->startTime, sizeof(trace->startTime), 1, trace->fp) != 1)
+        return 0;
+
+    return 1;
+}
+
+int TraceRead(struct tracefile* trace, struct traceevent* event)
+{
+    uint64_t delta, id;
+
+    int type = fgetc(trace->fp);
+    if (type == EOF)
+        return 0;
+
+    if (!TraceReadVarint(trace->fp, &delta) || !TraceReadVarint(trace->fp, &id))
+        return -1;
+
+    if (id > UINT32_MAX)
+        return -1; // note ids are 32 bits
+
+    memset(event, 0, sizeof(struct traceevent));
+    trace->lastTime += delta;
+
+    event->type = type;
+    event->time = trace->lastTime;
+    event->id = id;
+
+    switch (type)
+    {
+        case TRACE_EDIT_CHANGE:
+        {
+            uint64_t prefixLen, suffixLen, insertLen;
+
+            if (!TraceReadVarint(trace->fp, &prefixLen) || !TraceReadVarint(trace->fp, &suffixLen) || !TraceReadVarint(trace->fp, &insertLen))
+                return -1;
+
+            if (insertLen > UINT32_MAX - 1)
+                return -1;
+
+            // grow the buffer for the inserted text
+            if (insertLen + 1 > trace->bufferSize)
+            {
+                char* new_buffer = (char*)realloc(trace->buffer, insertLen + 1);
+                if (new_buffer == NULL)
+                    return -1;
+
+                trace->buffer = new_buffer;
+                trace->bufferSize = insertLen + 1;
+            }
+
+            if (fread(trace->buffer, sizeof(char), insertLen, trace->fp) != insertLen)
+                return -1;
+
+            trace->buffer[insertLen] = '\0';
+
+            event->prefixLen = prefixLen;
+            event->suffixLen = suffixLen;
+            event->insertLen = insertLen;
+            event->insert = trace->buffer;
+        }
+        break;
+
+        case TRACE_MOVE:
+        case TRACE_SIZE:
+            if (!TraceReadSigned(trace->fp, &event->x) || !TraceReadSigned(trace->fp, &event->y) ||
+                !TraceReadSigned(trace->fp, &event->w) || !TraceReadSigned(trace->fp, &event->h))
+                return -1;
+        break;
+
+        case TRACE_REMIND:
+            if (!TraceReadVarint(trace->fp, &event->remind_at))
+                return -1;
+        break;
+
+        case TRACE_NOTE_NEW:
+        case TRACE_NOTE_DELETE:
+        case TRACE_ACTIVATE:
+        case TRACE_DEACTIVATE:
+        case TRACE_SAVE:
+        case TRACE_TAGS:
+        break;
+
+        default: // unknown event
+            return -1;
+    }
+
+    return 1;
+}
+
+void TraceClose(struct tracefile* trace)
+{
+    if (trace->fp != NULL)
+        fclose(trace->fp);
+
+    free(trace->buffer);
+    memset(trace, 0, sizeof(struct tracefile));
+}
@@ -0,0 +1,81 @@
+/* ===================================================================================  //
+//    This program is free software: you can redistribute it and/or modify              //
+//    it under the terms of the GNU General Public License as published by              //
+//    the Free Software Foundation, either version 3 of the License, or                 //
+//    (at your option) any later version.                                               //
+//                                                                                      //
+//    This program is distributed in the hope that it will be useful,                   //
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of                    //
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                     //
+//    GNU General Public License for more details.                                      //
+//                                                                                      //
+//    You should have received a copy of the GNU General Public License                 //
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>5.           //
+//                                                                                      //
+//    Copyright: Luiz Gustavo Pfitscher e Feldmann, 2020                                //
+// ===================================================================================  */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// kinds of recorded events - each is a window message and the change it made to the notes
+enum traceeventtype
+{
+    TRACE_NOTE_NEW = 1,     // note created (also written for every loaded note when recording starts)
+    TRACE_NOTE_DELETE,      // note deleted
+    TRACE_EDIT_CHANGE,      // EN_CHANGE - new text, stored as a difference to the previous one
+    TRACE_MOVE,             // WM_MOVE - new placement
+    TRACE_SIZE,             // WM_SIZE - new placement
+    TRACE_ACTIVATE,         // WM_ACTIVATE - note became active
+    TRACE_DEACTIVATE,       // WM_ACTIVATE - note lost focus
+    TRACE_REMIND,           // reminder set or cleared
+    TRACE_SAVE,             // notes file rewritten
+    TRACE_TAGS,             // new #tags created from the text, outside of a deactivation (loaded and new notes)
+};
+
+struct traceevent
+{
+    uint8_t type;
+    uint64_t time;          // microseconds since recording started
+    uint32_t id;            // note the event applies to
+
+    int32_t x, y, w, h;     // TRACE_MOVE, TRACE_SIZE
+    uint64_t remind_at;     // TRACE_REMIND
+
+    // TRACE_EDIT_CHANGE - the new text keeps the first prefixLen and last suffixLen chars of the old one
+    // and has insertLen chars from insert between them
+    uint32_t prefixLen;
+    uint32_t suffixLen;
+    uint32_t insertLen;
+    const char* insert;
+};
+
+// compact binary trace: a header followed by records made of a type byte and variable length integers
+struct tracefile
+{
+    FILE* fp;
+    uint64_t lastTime;
+    uint32_t fontSize;      // size of the font record in the notes file of the recording app
+    uint64_t startTime;     // wall clock when recording started, in the units of the reminders - zero if unknown
+
+    char* buffer;           // holds the inserted text of the last event read
+    uint32_t bufferSize;
+};
+
+// recording - every call does nothing when the trace is not open
+int TraceCreate(struct tracefile* trace, const char* filename, uint32_t fontSize, uint64_t startTime);
+void TraceEvent(struct tracefile* trace, uint8_t type, uint32_t id, uint64_t time);
+void TraceText(struct tracefile* trace, uint32_t id, uint64_t time, const char* oldText, const char* newText);
+void TracePlacement(struct tracefile* trace, uint8_t type, uint32_t id, uint64_t time, int32_t x, int32_t y, int32_t w, int32_t h);
+void TraceReminder(struct tracefile* trace, uint32_t id, uint64_t time, uint64_t remind_at);
+
+// replaying - TraceRead returns 1 for each event, 0 at the end of the trace and -1 when it is malformed
+int TraceOpen(struct tracefile* trace, const char* filename);
+int TraceRead(struct tracefile* trace, struct traceevent* event);
+
+void TraceClose(struct tracefile* trace);
+
+#endif // TRACE_H